@@ -19,9 +19,12 @@
 #include <fstream>
 #include <iostream>
 #include <istream>
+#include <sstream>
 #include <vector>
 
+#include "engine.h"
 #include "position.h"
+#include "uci.h"
 
 using namespace std;
 
@@ -172,4 +175,56 @@ vector<string> setup_bench(const Position& current, istream& is) {
   return list;
 }
 
+
+/// setup_positions() returns the positions of a FEN or EPD file, or of the
+/// bench positions ("default" or "current"), as FEN strings, with the moves
+/// that follow them already played, and tells which ones are Chess960.
+
+vector<string> setup_positions(Engine& engine, const string& fenFile, vector<bool>& chess960) {
+
+  istringstream is("16 1 1 " + fenFile + " depth NNUE");
+  vector<string> fens;
+  string token;
+  bool isChess960 = engine.options["UCI_Chess960"];
+
+  for (const auto& cmd : setup_bench(engine.pos, is))
+      if (cmd.find("setoption name UCI_Chess960 value ") == 0)
+          isChess960 = cmd.substr(34) == "true";
+
+      else if (cmd.find("position fen ") == 0)
+      {
+          // EPD records have operations instead of the move counters, so keep
+          // the counters only when present, then play the moves if any.
+          size_t movesIdx = cmd.find(" moves ");
+          istringstream ss(cmd.substr(13, movesIdx == string::npos ? string::npos : movesIdx - 13));
+          string field, fen;
+          for (int i = 0; i < 6 && ss >> field; ++i)
+          {
+              if (i >= 4 && field.find_first_not_of("0123456789") != string::npos)
+                  break;
+              fen += (i ? " " : "") + field;
+          }
+
+          Position p;
+          StateListPtr states(new std::deque<StateInfo>(1));
+          p.set(fen, isChess960, &states->back(), engine.threads.main());
+
+          if (movesIdx != string::npos)
+          {
+              istringstream moves(cmd.substr(movesIdx + 7));
+              Move m;
+              while (moves >> token && (m = UCI::to_move(p, token)) != MOVE_NONE)
+              {
+                  states->emplace_back();
+                  p.do_move(m, states->back());
+              }
+          }
+
+          fens.push_back(p.fen());
+          chess960.push_back(isChess960);
+      }
+
+  return fens;
+}
+
 } // namespace Stockfish
@@ -0,0 +1,552 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "datagen.h"
+#include "engine.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "movegen.h"
+#include "selfplay.h"
+#include "uci.h"
+
+using namespace std;
+
+namespace Stockfish {
+
+extern vector<string> setup_positions(Engine&, const string&, vector<bool>&);
+
+namespace Datagen {
+
+namespace {
+
+  // Huffman code of the piece types, the color of a piece follows its code
+  struct HuffmanCode { int code, bits; };
+  constexpr HuffmanCode PieceCode[] = {
+      { 0b0000, 1 }, // NO_PIECE_TYPE
+      { 0b0001, 4 }, // PAWN
+      { 0b0011, 4 }, // KNIGHT
+      { 0b0101, 4 }, // BISHOP
+      { 0b0111, 4 }, // ROOK
+      { 0b1001, 4 }  // QUEEN
+  };
+
+  // BitWriter writes to a byte array, starting from the low bit of each byte
+  struct BitWriter {
+
+    explicit BitWriter(uint8_t* d) : data(d) {}
+
+    void write(int value, int bits) {
+      for (int i = 0; i < bits; ++i, ++cursor)
+          if (value & (1 << i))
+              data[cursor / 8] |= uint8_t(1 << (cursor % 8));
+    }
+
+    uint8_t* data;
+    int cursor = 0;
+  };
+
+  // BitReader reads what BitWriter has written
+  struct BitReader {
+
+    explicit BitReader(const uint8_t* d) : data(d) {}
+
+    int read(int bits) {
+      int value = 0;
+      for (int i = 0; i < bits; ++i, ++cursor)
+          value |= ((data[cursor / 8] >> (cursor % 8)) & 1) << i;
+      return value;
+    }
+
+    const uint8_t* data;
+    int cursor = 0;
+  };
+
+  // The positions go through the queues in batches: one per game for gensfen(),
+  // with a few of them per thread in the queue, and of RescoreBatch for rescore().
+  typedef vector<PackedSfenValue> Batch;
+
+  constexpr size_t QueueBatchesPerThread = 16;
+  constexpr size_t RescoreBatch = 1024;
+
+  // The stages of rescore() are timed in microseconds, as a batch may be read
+  // or written in much less than a millisecond.
+  int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>
+          (std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+} // namespace
+
+
+/// pack() encodes a position in 256 bits: the side to move, the king squares,
+/// the other squares from a8 to h1 with the Huffman code of their piece, the
+/// castling rights, the en passant square and the move counters.
+
+void pack(const Position& pos, uint8_t sfen[32]) {
+
+  std::memset(sfen, 0, 32);
+  BitWriter stream(sfen);
+
+  stream.write(pos.side_to_move(), 1);
+  stream.write(pos.square<KING>(WHITE), 6);
+  stream.write(pos.square<KING>(BLACK), 6);
+
+  for (Rank r = RANK_8; r >= RANK_1; --r)
+      for (File f = FILE_A; f <= FILE_H; ++f)
+      {
+          Piece pc = pos.piece_on(make_square(f, r));
+          if (type_of(pc) == KING)
+              continue;
+
+          stream.write(PieceCode[type_of(pc)].code, PieceCode[type_of(pc)].bits);
+          if (pc != NO_PIECE)
+              stream.write(color_of(pc), 1);
+      }
+
+  stream.write(pos.can_castle(WHITE_OO), 1);
+  stream.write(pos.can_castle(WHITE_OOO), 1);
+  stream.write(pos.can_castle(BLACK_OO), 1);
+  stream.write(pos.can_castle(BLACK_OOO), 1);
+
+  stream.write(pos.ep_square() != SQ_NONE, 1);
+  if (pos.ep_square() != SQ_NONE)
+      stream.write(pos.ep_square(), 6);
+
+  int fullMove = 1 + (pos.game_ply() - (pos.side_to_move() == BLACK)) / 2;
+  stream.write(pos.rule50_count(), 6);
+  stream.write(fullMove, 8);
+  stream.write(fullMove >> 8, 8);
+  stream.write(pos.rule50_count() >> 6, 1);
+
+  assert(stream.cursor <= 256);
+}
+
+
+/// unpack() decodes a position encoded by pack() and returns its FEN string
+
+string unpack(const uint8_t sfen[32]) {
+
+  BitReader stream(sfen);
+  Piece board[SQUARE_NB] = {};
+
+  Color us = Color(stream.read(1));
+  for (Color c : { WHITE, BLACK })
+      board[stream.read(6)] = make_piece(c, KING);
+
+  for (Rank r = RANK_8; r >= RANK_1; --r)
+      for (File f = FILE_A; f <= FILE_H; ++f)
+      {
+          Square s = make_square(f, r);
+          if (type_of(board[s]) == KING || !stream.read(1))
+              continue;
+
+          // The first bit of a piece code is always set, read the other three
+          int code = 1 | (stream.read(3) << 1);
+          PieceType pt = PAWN;
+          while (PieceCode[pt].code != code && pt < QUEEN)
+              ++pt;
+
+          board[s] = make_piece(Color(stream.read(1)), pt);
+      }
+
+  ostringstream ss;
+  for (Rank r = RANK_8; r >= RANK_1; --r)
+  {
+      for (File f = FILE_A; f <= FILE_H; ++f)
+      {
+          int empty = 0;
+          for ( ; f <= FILE_H && board[make_square(f, r)] == NO_PIECE; ++f)
+              ++empty;
+
+          if (empty)
+              ss << empty;
+
+          if (f <= FILE_H)
+              ss << " PNBRQK  pnbrqk"[board[make_square(f, r)]];
+      }
+
+      if (r > RANK_1)
+          ss << '/';
+  }
+
+  ss << (us == WHITE ? " w " : " b ");
+
+  string castling;
+  for (const char* cr = "KQkq"; *cr; ++cr)
+      if (stream.read(1))
+          castling += *cr;
+
+  ss << (castling.empty() ? "-" : castling);
+
+  if (stream.read(1))
+      ss << " " << UCI::square(Square(stream.read(6)));
+  else
+      ss << " -";
+
+  int rule50 = stream.read(6);
+  int fullMove = stream.read(8);
+  fullMove |= stream.read(8) << 8;
+  rule50 |= stream.read(1) << 6;
+
+  ss << " " << rule50 << " " << std::max(fullMove, 1);
+
+  return ss.str();
+}
+
+
+/// gensfen() is called when the engine receives the "gensfen" command. It plays
+/// games with a fixed depth or number of nodes per move, as many at the same time
+/// as there are threads, and writes all the positions of the games, with their
+/// score, best move and result, to a file of the ".bin" format. The games start
+/// from the positions of a book, or from the current position, followed by a few
+/// random moves. The file is written by a dedicated thread, through a bounded
+/// queue, so that the search threads never wait for the disk:
+/// gensfen [depth|nodes] [limit] [count] [outputFile] [bookFile] [randomPlies]
+
+void gensfen(Engine& engine, istream& args) {
+
+  string token;
+  string limitType  = (args >> token) ? token : "depth";
+  string limit      = (args >> token) ? token : "8";
+  string countArg   = (args >> token) ? token : "1000000";
+  string outputFile = (args >> token) ? token : "generated.bin";
+  string bookFile   = (args >> token) ? token : "current";
+  string pliesArg   = (args >> token) ? token : "8";
+
+  if (limitType != "depth" && limitType != "nodes")
+  {
+      sync_cout << "Unknown limit type " << limitType << sync_endl;
+      return;
+  }
+
+  int64_t number;
+  if (!parse_number(limit, number) || number < 1 || number > INT_MAX)
+  {
+      sync_cout << "Invalid limit " << limit << sync_endl;
+      return;
+  }
+
+  if (!parse_number(countArg, number) || number < 1)
+  {
+      sync_cout << "Invalid number of positions " << countArg << sync_endl;
+      return;
+  }
+
+  uint64_t count = uint64_t(number);
+
+  if (!parse_number(pliesArg, number) || number < 0 || number > MAX_PLY)
+  {
+      sync_cout << "Invalid number of random plies " << pliesArg << sync_endl;
+      return;
+  }
+
+  int randomPlies = int(number);
+
+  ofstream file(outputFile, ios::binary | ios::app);
+  if (!file)
+  {
+      sync_cout << "Unable to open file " << outputFile << sync_endl;
+      return;
+  }
+
+  vector<bool> chess960;
+  vector<string> fens = setup_positions(engine, bookFile, chess960);
+
+  engine.hot_swap();
+  Eval::NNUE::verify(engine);
+
+  size_t workers = engine.threads.size();
+  size_t hashMB = std::max(size_t(engine.options["Hash"]) / workers, size_t(1));
+
+  vector<std::unique_ptr<Engine>> players;
+  for (size_t i = 0; i < workers; ++i)
+      players.push_back(Selfplay::new_player(engine, hashMB));
+
+  BoundedQueue<Batch> queue(QueueBatchesPerThread * workers);
+  std::atomic<uint64_t> generated(0), games(0);
+  uint64_t written = 0;
+  TimePoint elapsed = now();
+
+  auto worker = [&](size_t idx) {
+
+      PRNG rng(uint64_t(now()) * 6364136223846793005ULL + idx + 1);
+      Engine* player = players[idx].get();
+      Engine* colors[COLOR_NB] = { player, player };
+
+      while (generated < count)
+      {
+          size_t n = rng.rand<size_t>() % fens.size();
+          Selfplay::Game game;
+          game.chess960 = chess960[n];
+
+          // Play the random moves of the opening
+          Position pos;
+          StateListPtr states(new std::deque<StateInfo>(1));
+          pos.set(fens[n], game.chess960, &states->back(), player->threads.main());
+
+          for (int i = 0; i < randomPlies; ++i)
+          {
+              MoveList<LEGAL> moves(pos);
+              if (!moves.size())
+                  break;
+
+              states->emplace_back();
+              pos.do_move(*(moves.begin() + rng.rand<size_t>() % moves.size()), states->back());
+          }
+
+          if (!MoveList<LEGAL>(pos).size())
+              continue;
+
+          game.fen = pos.fen();
+          Selfplay::play(colors, limitType + " " + limit, game);
+
+          // Replay the game to pack its positions
+          Batch batch(game.moves.size());
+          states = StateListPtr(new std::deque<StateInfo>(1));
+          pos.set(game.fen, game.chess960, &states->back(), player->threads.main());
+
+          for (size_t i = 0; i < game.moves.size(); ++i)
+          {
+              PackedSfenValue& psv = batch[i];
+              pack(pos, psv.sfen);
+              psv.score = int16_t(std::clamp(game.scores[i], -VALUE_MATE, VALUE_MATE));
+              psv.move = uint16_t(game.moves[i]);
+              psv.gamePly = uint16_t(pos.game_ply());
+              psv.gameResult = int8_t(pos.side_to_move() == WHITE ? game.result : -game.result);
+              psv.padding = 0;
+
+              states->emplace_back();
+              pos.do_move(game.moves[i], states->back());
+          }
+
+          generated += batch.size();
+          ++games;
+          queue.push(std::move(batch));
+      }
+  };
+
+  // The writer stops at the requested number of positions
+  std::thread writer([&]() {
+
+      Batch batch;
+      while (queue.pop(batch))
+      {
+          size_t n = size_t(std::min(uint64_t(batch.size()), count - written));
+          file.write(reinterpret_cast<const char*>(batch.data()), std::streamsize(n * sizeof(PackedSfenValue)));
+
+          if ((written + n) / 100000 != written / 100000)
+              sync_cout << "info string gensfen " << written + n << " positions, "
+                        << 1000 * (written + n) / (now() - elapsed + 1) << " positions/second" << sync_endl;
+
+          written += n;
+      }
+  });
+
+  vector<std::thread> threads;
+  for (size_t idx = 0; idx < workers; ++idx)
+      threads.emplace_back(worker, idx);
+
+  for (auto& th : threads)
+      th.join();
+
+  queue.close();
+  writer.join();
+  file.close();
+
+  elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+
+  cerr << "\n==========================="
+       << "\nGames played       : " << games
+       << "\nPositions written  : " << written
+       << "\nTotal time (ms)    : " << elapsed
+       << "\nPositions/second   : " << 1000 * written / elapsed << endl;
+}
+
+
+
+/// rescore() is called when the engine receives the "rescore" command. It gives
+/// new scores to the positions of a ".bin" file, with the evaluation of the
+/// engine ("eval"), the raw output of the main network ("nnue"), or a search of
+/// the given depth, which also replaces the best moves. The file is streamed in
+/// batches through a pipeline of bounded queues: a reader thread, one scoring
+/// worker per thread and a writer thread, so that the memory used does not depend
+/// on the size of the file. The order of the positions is not preserved:
+/// rescore [inputFile] [outputFile] [eval|nnue|depth] [depth]
+
+void rescore(Engine& engine, istream& args) {
+
+  string token;
+  string inputFile  = (args >> token) ? token : "generated.bin";
+  string outputFile = (args >> token) ? token : "rescored.bin";
+  string scoreType  = (args >> token) ? token : "eval";
+  string depth      = (args >> token) ? token : "1";
+
+  if (scoreType != "eval" && scoreType != "nnue" && scoreType != "depth")
+  {
+      sync_cout << "Unknown score type " << scoreType << sync_endl;
+      return;
+  }
+
+  ifstream in(inputFile, ios::binary);
+  ofstream out(outputFile, ios::binary | ios::trunc);
+  if (!in || !out)
+  {
+      sync_cout << "Unable to open file " << (!in ? inputFile : outputFile) << sync_endl;
+      return;
+  }
+
+  engine.hot_swap();
+  Eval::NNUE::verify(engine);
+
+  if (scoreType == "nnue" && !Eval::useNNUE)
+  {
+      sync_cout << "info string the nnue score type needs \"Use NNUE\" set to true" << sync_endl;
+      return;
+  }
+
+  size_t workers = engine.threads.size();
+  size_t hashMB = std::max(size_t(engine.options["Hash"]) / workers, size_t(1));
+
+  vector<std::unique_ptr<Engine>> players;
+  for (size_t i = 0; i < workers; ++i)
+      players.push_back(Selfplay::new_player(engine, hashMB));
+
+  BoundedQueue<Batch> toScore(4 * workers), toWrite(4 * workers);
+  std::atomic<int64_t> scoreTime(0);
+  int64_t readTime = 0, writeTime = 0;
+  uint64_t read = 0, written = 0;
+  TimePoint elapsed = now();
+
+  std::thread reader([&]() {
+
+      while (true)
+      {
+          int64_t start = now_us();
+          Batch batch(RescoreBatch);
+          in.read(reinterpret_cast<char*>(batch.data()), std::streamsize(RescoreBatch * sizeof(PackedSfenValue)));
+          batch.resize(size_t(in.gcount()) / sizeof(PackedSfenValue));
+          readTime += now_us() - start;
+
+          if (batch.empty())
+              break;
+
+          read += batch.size();
+          toScore.push(std::move(batch));
+      }
+
+      toScore.close();
+  });
+
+  auto worker = [&](size_t idx) {
+
+      Engine* player = players[idx].get();
+      MainThread* th = player->threads.main();
+      Batch batch;
+
+      while (toScore.pop(batch))
+      {
+          int64_t start = now_us();
+
+          for (PackedSfenValue& psv : batch)
+          {
+              string fen = unpack(psv.sfen);
+
+              if (scoreType == "depth")
+              {
+                  istringstream position("fen " + fen), go("depth " + depth);
+                  player->position(position);
+                  player->go(go);
+                  player->wait_for_search_finished();
+
+                  psv.score = int16_t(th->bestPreviousScore);
+                  psv.move = uint16_t(th->bestMove);
+                  continue;
+              }
+
+              Position pos;
+              StateInfo st;
+              pos.set(fen, false, &st, th);
+              th->optimism[WHITE] = th->optimism[BLACK] = VALUE_ZERO;
+
+              Value v = scoreType == "nnue" ? Eval::NNUE::evaluate<Eval::NNUE::Big>(pos)
+                                            : Eval::evaluate(pos);
+              psv.score = int16_t(v);
+          }
+
+          scoreTime += now_us() - start;
+          toWrite.push(std::move(batch));
+      }
+  };
+
+  std::thread writer([&]() {
+
+      Batch batch;
+      while (toWrite.pop(batch))
+      {
+          int64_t start = now_us();
+          out.write(reinterpret_cast<const char*>(batch.data()), std::streamsize(batch.size() * sizeof(PackedSfenValue)));
+          writeTime += now_us() - start;
+
+          if ((written + batch.size()) / 100000 != written / 100000)
+              sync_cout << "info string rescore " << written + batch.size() << " positions, "
+                        << 1000 * (written + batch.size()) / (now() - elapsed + 1) << " positions/second" << sync_endl;
+
+          written += batch.size();
+      }
+  });
+
+  vector<std::thread> threads;
+  for (size_t idx = 0; idx < workers; ++idx)
+      threads.emplace_back(worker, idx);
+
+  reader.join();
+  for (auto& th : threads)
+      th.join();
+
+  toWrite.close();
+  writer.join();
+  out.close();
+
+  elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+
+  // The throughput of each stage on its own, from the time it was busy
+  auto rate = [](uint64_t n, int64_t t) { return 1000000 * n / uint64_t(std::max(t, int64_t(1))); };
+
+  cerr << "\n==========================="
+       << "\nPositions read     : " << read
+       << "\nPositions written  : " << written
+       << "\nTotal time (ms)    : " << elapsed
+       << "\nPositions/second   : " << 1000 * written / elapsed
+       << "\nRead               : " << rate(read, readTime) << " positions/second"
+       << "\nScore              : " << rate(written, scoreTime) << " positions/second per thread"
+       << "\nWrite              : " << rate(written, writeTime) << " positions/second" << endl;
+}
+
+} // namespace Datagen
+
+} // namespace Stockfish
@@ -0,0 +1,60 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DATAGEN_H_INCLUDED
+#define DATAGEN_H_INCLUDED
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Engine;
+class Position;
+
+namespace Datagen {
+
+/// PackedSfenValue is a training position of the ".bin" format used by the
+/// NNUE trainers: the position packed in 256 bits with a Huffman code of the
+/// pieces, the score and the best move from the point of view of the side to
+/// move, the game ply and the result of the game for the side to move.
+
+struct PackedSfenValue {
+  uint8_t sfen[32];
+  int16_t score;
+  uint16_t move;
+  uint16_t gamePly;
+  int8_t gameResult; // 1, 0 or -1 for a win, a draw or a loss
+  uint8_t padding;
+};
+
+static_assert(sizeof(PackedSfenValue) == 40, "PackedSfenValue must be 40 bytes");
+
+void pack(const Position& pos, uint8_t sfen[32]);
+std::string unpack(const uint8_t sfen[32]);
+void gensfen(Engine& engine, std::istream& args);
+void rescore(Engine& engine, std::istream& args);
+
+} // namespace Datagen
+
+} // namespace Stockfish
+
+#endif // #ifndef DATAGEN_H_INCLUDED
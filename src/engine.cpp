@@ -0,0 +1,477 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "bitboard.h"
+#include "endgame.h"
+#include "engine.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "psqt.h"
+#include "stockfish.h"
+
+using namespace std;
+
+namespace Stockfish {
+
+namespace {
+
+  // FEN string for the initial position in standard chess
+  const char* StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+  // All the engines of the process, which share the NNUE networks, and the
+  // number of times the networks were swapped. The lock is held while the
+  // networks are swapped and while a search is started, see Engine::hot_swap().
+  std::mutex enginesMutex;
+  std::vector<Engine*> engines;
+  uint64_t networkSwapCount = 0;
+
+  // The options that act on the whole process, see Engine::shared_option()
+  const std::set<string, UCI::CaseInsensitiveLess> SharedOptions = {
+    "EvalFile", "EvalFileSmall", "Use NNUE", "NNUE Eager Update", "NNUE Prefetch",
+    "NNUE Hot Swap", "SyzygyPath"
+  };
+
+} // namespace
+
+
+/// Engine constructor sets up the UCI options with their default values, then
+/// launches the threads, which also allocates the transposition table. The
+/// shared options take the values of the other engines, if any. The position
+/// must be set with position() before the first search, because the tables
+/// used by Position::set() may not be initialized yet at this point.
+
+Engine::Engine(OutputFn fn) : threads(*this), time(limits, threads),
+                              states(new std::deque<StateInfo>(1)), outputFn(fn) {
+
+  UCI::init(options, *this);
+  threads.set(size_t(options["Threads"]));
+  clear(); // After threads are up
+
+  std::lock_guard<std::mutex> lk(enginesMutex);
+
+  if (!engines.empty())
+      for (const string& name : SharedOptions)
+          options[name].copy_value(engines.front()->options[name]);
+
+  engines.push_back(this);
+  networkSwaps = networkSwapCount;
+}
+
+
+/// Engine destructor waits for the current search, if any, and terminates the
+/// threads before the members they refer to are destroyed.
+
+Engine::~Engine() {
+
+  threads.stop = true;
+  threads.set(0);
+
+  std::lock_guard<std::mutex> lk(enginesMutex);
+  engines.erase(std::find(engines.begin(), engines.end(), this));
+}
+
+
+/// Engine::position() sets up the position that is described in the given FEN
+/// string ("fen") or the initial position ("startpos") and then makes the moves
+/// given in the following move list ("moves").
+
+void Engine::position(istream& is) {
+
+  Move m;
+  string token, fen;
+
+  is >> token;
+
+  if (token == "startpos")
+  {
+      fen = StartFEN;
+      is >> token; // Consume the "moves" token, if any
+  }
+  else if (token == "fen")
+      while (is >> token && token != "moves")
+          fen += token + " ";
+  else
+      return;
+
+  states = StateListPtr(new std::deque<StateInfo>(1)); // Drop the old state and create a new one
+  pos.set(fen, options["UCI_Chess960"], &states->back(), threads.main());
+
+  // Parse the move list, if any
+  while (is >> token && (m = UCI::to_move(pos, token)) != MOVE_NONE)
+  {
+      states->emplace_back();
+      pos.do_move(m, states->back());
+  }
+}
+
+
+/// Engine::go() sets the thinking time and other parameters from the input
+/// string, then starts with a search. It returns immediately, the result is
+/// reported through output() when the search is finished.
+
+void Engine::go(istream& is) {
+
+  Search::LimitsType newLimits;
+  string token;
+  bool ponderMode = false;
+
+  newLimits.startTime = now(); // The search starts as early as possible
+
+  while (is >> token)
+      if (token == "searchmoves") // Needs to be the last command on the line
+          while (is >> token)
+              newLimits.searchmoves.push_back(UCI::to_move(pos, token));
+
+      else if (token == "wtime")     is >> newLimits.time[WHITE];
+      else if (token == "btime")     is >> newLimits.time[BLACK];
+      else if (token == "winc")      is >> newLimits.inc[WHITE];
+      else if (token == "binc")      is >> newLimits.inc[BLACK];
+      else if (token == "movestogo") is >> newLimits.movestogo;
+      else if (token == "depth")     is >> newLimits.depth;
+      else if (token == "nodes")     is >> newLimits.nodes;
+      else if (token == "movetime")  is >> newLimits.movetime;
+      else if (token == "mate")      is >> newLimits.mate;
+      else if (token == "perft")     is >> newLimits.perft;
+      else if (token == "infinite")  newLimits.infinite = 1;
+      else if (token == "ponder")    ponderMode = true;
+
+  // The previous search must be over before the networks may be swapped, and
+  // before the state of the output is reset.
+  wait_for_search_finished();
+
+  lastInfo = 0;
+  infoDropped = false;
+
+  std::lock_guard<std::mutex> lk(enginesMutex);
+  install_networks();
+  threads.start_thinking(pos, states, newLimits, ponderMode);
+}
+
+
+/// Engine::setoption() updates the UCI option ("name") to the given value ("value"),
+/// see set_option().
+
+void Engine::setoption(istream& is) {
+
+  string token, name, value;
+
+  is >> token; // Consume the "name" token
+
+  // Read the option name (can contain spaces)
+  while (is >> token && token != "value")
+      name += (name.empty() ? "" : " ") + token;
+
+  // Read the option value (can contain spaces)
+  while (is >> token)
+      value += (value.empty() ? "" : " ") + token;
+
+  set_option(name, value);
+}
+
+
+/// Engine::set_option() sets an option to the given value, and returns false if
+/// there is no such option, or if it is a shared option while there are other
+/// engines, since changing it would change the networks or the tablebases
+/// under their searches.
+
+bool Engine::set_option(const string& name, const string& value) {
+
+  if (!options.count(name))
+  {
+      output("No such option: " + name);
+      return false;
+  }
+
+  if (!shared_option(name))
+  {
+      options[name] = value;
+      return true;
+  }
+
+  std::lock_guard<std::mutex> lk(enginesMutex);
+
+  if (engines.size() > 1)
+  {
+      output("info string ERROR: " + name + " is shared by all the engines of the process"
+             " and cannot be set while there are several");
+      return false;
+  }
+
+  options[name] = value;
+  return true;
+}
+
+
+/// Engine::shared_option() tells if an option acts on the whole process, as the
+/// options of the NNUE networks and of the tablebases.
+
+bool Engine::shared_option(const string& name) {
+
+  return SharedOptions.count(name);
+}
+
+
+/// Engine::instances() returns the number of engines of the process
+
+size_t Engine::instances() {
+
+  std::lock_guard<std::mutex> lk(enginesMutex);
+  return engines.size();
+}
+
+
+/// Engine::stop() and Engine::ponderhit() are called on the 'stop' and
+/// 'ponderhit' commands, the search continues in the latter case but
+/// switches from pondering to the normal search.
+
+void Engine::stop() {
+
+  threads.stop = true;
+}
+
+void Engine::ponderhit() {
+
+  threads.main()->ponder = false;
+}
+
+
+/// Engine::clear() resets the search state, usually before a new game
+
+void Engine::clear() {
+
+  wait_for_search_finished();
+
+  time.availableNodes = 0;
+  tt.clear(threads);
+  threads.clear();
+}
+
+
+/// Engine::wait_for_search_finished() blocks until the current search, if any,
+/// has finished and its best move has been reported.
+
+void Engine::wait_for_search_finished() {
+
+  threads.main()->wait_for_search_finished();
+
+  if (!outputFn)
+      async_cout_flush();
+}
+
+
+/// Engine::hot_swap() installs the networks loaded in the background by "NNUE
+/// Hot Swap", if any, before the engine evaluates positions. It is called by
+/// go() and by the commands that evaluate without it.
+
+void Engine::hot_swap() {
+
+  std::lock_guard<std::mutex> lk(enginesMutex);
+  install_networks();
+}
+
+
+/// Engine::install_networks() does the work of hot_swap() with the engines
+/// locked. The networks are shared by all the engines, so they are only
+/// swapped when no other engine is searching, else at a later call. Then the
+/// accumulators of the position of each engine, computed with the old networks,
+/// are marked as stale, which the other engines do when they next get here.
+
+void Engine::install_networks() {
+
+  if (Eval::NNUE::swap_pending())
+  {
+      if (std::any_of(engines.begin(), engines.end(),
+                      [&](Engine* e) { return e != this && e->threads.searching(); }))
+          output("info string NNUE networks not swapped yet, another engine is searching");
+
+      else if (Eval::NNUE::hot_swap(options))
+          networkSwapCount++;
+  }
+
+  if (networkSwaps != networkSwapCount)
+  {
+      for (StateInfo* st = pos.state(); st; st = st->previous)
+      {
+          st->accumulatorBig.computed[WHITE] = st->accumulatorBig.computed[BLACK] = false;
+          st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
+      }
+
+      networkSwaps = networkSwapCount;
+  }
+}
+
+
+/// Engine::output() sends a line of the search output to the callback of the
+/// engine, or to stdout when there is none. The callback is never called by
+/// two threads of the same engine at the same time. With "Async Output" the
+/// lines for stdout are written by the I/O thread, see async_cout().
+
+void Engine::output(const string& line) {
+
+  if (!outputFn)
+  {
+      if (options["Async Output"])
+          async_cout(line);
+      else
+          sync_cout << line << sync_endl;
+      return;
+  }
+
+  std::lock_guard<std::mutex> lk(outputMutex);
+  outputFn(line);
+}
+
+
+/// Engine::binary_output() tells if the PV and the best move are sent as frames
+/// of the binary output. This is only done on stdout, the callbacks of the
+/// library always get text lines.
+
+bool Engine::binary_output() {
+
+  return !outputFn && options["Binary Output"];
+}
+
+
+/// Engine::info_allowed() is called by the main thread before it builds an
+/// "info" line with the PV or the current move. It returns false when the last
+/// one was sent less than "Info Interval" ms ago, in which case the PV is sent
+/// again before the best move, so that the GUI gets the final score anyway.
+
+bool Engine::info_allowed() {
+
+  TimePoint interval = TimePoint(int(options["Info Interval"]));
+  TimePoint t = now();
+
+  if (interval && lastInfo && t - lastInfo < interval)
+  {
+      infoDropped = true;
+      return false;
+  }
+
+  lastInfo = t;
+  infoDropped = false;
+  return true;
+}
+
+} // namespace Stockfish
+
+
+/// The C interface of the library, see stockfish.h. An sf_engine is an Engine,
+/// the string arguments are parsed as the arguments of the UCI commands.
+
+using namespace Stockfish;
+
+struct sf_engine : public Engine {
+  using Engine::Engine;
+};
+
+namespace {
+
+  std::once_flag initFlag;
+
+  void run(void (Engine::*f)(istream&), sf_engine* e, const char* args) {
+
+    istringstream is(args ? args : "");
+    (e->*f)(is);
+  }
+
+} // namespace
+
+extern "C" {
+
+void sf_init(const char* argv0) {
+
+  std::call_once(initFlag, [argv0]() {
+      char* argv[] = { const_cast<char*>(argv0 ? argv0 : "stockfish"), nullptr };
+      CommandLine::init(1, argv);
+      PSQT::init();
+      Bitboards::init();
+      Position::init();
+      Bitbases::init();
+      Endgames::init();
+  });
+}
+
+sf_engine* sf_engine_new(sf_output_fn fn, void* userdata) {
+
+  sf_init(nullptr);
+
+  Engine::OutputFn out = nullptr;
+  if (fn)
+      out = [fn, userdata](const string& line) { fn(line.c_str(), userdata); };
+
+  // The networks are loaded by the first engine only, the others share them
+  sf_engine* e = new sf_engine(out);
+  if (Engine::instances() == 1)
+      Eval::NNUE::init(e->options);
+  run(&Engine::position, e, "startpos");
+  return e;
+}
+
+void sf_engine_delete(sf_engine* e) {
+
+  delete e;
+}
+
+int sf_engine_setoption(sf_engine* e, const char* name, const char* value) {
+
+  if (!name || !e->options.count(name))
+      return -1;
+
+  e->wait_for_search_finished();
+  return e->set_option(name, value ? value : "") ? 0 : -2;
+}
+
+void sf_engine_position(sf_engine* e, const char* args) {
+
+  e->wait_for_search_finished();
+  run(&Engine::position, e, args);
+}
+
+void sf_engine_go(sf_engine* e, const char* args) {
+
+  run(&Engine::go, e, args);
+}
+
+void sf_engine_stop(sf_engine* e) {
+
+  e->stop();
+}
+
+void sf_engine_ponderhit(sf_engine* e) {
+
+  e->ponderhit();
+}
+
+void sf_engine_wait(sf_engine* e) {
+
+  e->wait_for_search_finished();
+}
+
+void sf_engine_newgame(sf_engine* e) {
+
+  e->clear();
+}
+
+} // extern "C"
@@ -0,0 +1,97 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ENGINE_H_INCLUDED
+#define ENGINE_H_INCLUDED
+
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <string>
+
+#include "mcts.h"
+#include "pns.h"
+#include "position.h"
+#include "search.h"
+#include "thread.h"
+#include "timeman.h"
+#include "tt.h"
+#include "uci.h"
+#include "syzygy/tbprobe.h"
+
+namespace Stockfish {
+
+/// Engine keeps together the state of one engine instance: its UCI options,
+/// thread pool and transposition table, the limits, time management and
+/// tablebase parameters of the current search, and the position set up by the
+/// GUI. The executable runs a single Engine behind the UCI loop, while the
+/// library (see stockfish.h) may run any number of them in the same process.
+/// All the instances share the read-only tables, the NNUE networks and the
+/// tablebase files, so the options that change them act on the whole process:
+/// they can only be set while there is a single engine, and a new engine takes
+/// their values from the existing ones.
+
+class Engine {
+public:
+  typedef std::function<void(const std::string&)> OutputFn;
+
+  explicit Engine(OutputFn fn = nullptr);
+ ~Engine();
+
+  void position(std::istream& args);
+  void go(std::istream& args);
+  void setoption(std::istream& args);
+  bool set_option(const std::string& name, const std::string& value);
+  void stop();
+  void ponderhit();
+  void clear();
+  void wait_for_search_finished();
+  void hot_swap();
+  void output(const std::string& line);
+  bool info_allowed();
+  bool info_dropped() const { return infoDropped; }
+  bool binary_output();
+
+  static bool shared_option(const std::string& name);
+  static size_t instances();
+
+  UCI::OptionsMap options;
+  TranspositionTable tt;
+  ThreadPool threads;
+  Search::LimitsType limits;
+  TimeManagement time;
+  Tablebases::Config tbConfig;
+  MCTS::Tree mcts;
+  PNS::Solver pns;
+
+  Position pos;
+  StateListPtr states;
+
+private:
+  void install_networks();
+
+  OutputFn outputFn;
+  std::mutex outputMutex;
+  TimePoint lastInfo;
+  bool infoDropped;
+  uint64_t networkSwaps; // Seen by the position, see install_networks()
+};
+
+} // namespace Stockfish
+
+#endif // #ifndef ENGINE_H_INCLUDED
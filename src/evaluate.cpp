@@ -25,9 +25,11 @@
 #include <sstream>
 #include <iostream>
 #include <streambuf>
+#include <thread>
 #include <vector>
 
 #include "bitboard.h"
+#include "engine.h"
 #include "evaluate.h"
 #include "material.h"
 #include "misc.h"
@@ -61,25 +63,28 @@ namespace Stockfish {
 namespace Eval {
 
   bool useNNUE;
+  bool useSmallNNUE;
   string currentEvalFileName = "None";
+  string currentEvalFileSmallName = "None";
 
-  /// NNUE::init() tries to load a NNUE network at startup time, or when the engine
-  /// receives a UCI command "setoption name EvalFile value nn-[a-z0-9]{12}.nnue"
-  /// The name of the NNUE network is always retrieved from the EvalFile option.
-  /// We search the given network in three locations: internally (the default
-  /// network may be embedded in the binary), in the active working directory and
-  /// in the engine directory. Distro packagers may define the DEFAULT_NNUE_DIRECTORY
-  /// variable to have the engine search in a special directory in their distro.
+  // Names of the networks loaded aside by a hot swap, equal to the current
+  // ones when nothing is pending, and the thread that loads them.
+  string pendingEvalFileName = "None";
+  string pendingEvalFileSmallName = "None";
+  std::thread netLoader;
 
-  void NNUE::init() {
+  /// load_networks() loads the given networks, unless they are already loaded.
+  /// We search them in three locations: internally (the default network may be
+  /// embedded in the binary), in the active working directory and in the engine
+  /// directory. Distro packagers may define the DEFAULT_NNUE_DIRECTORY variable
+  /// to have the engine search in a special directory in their distro. With
+  /// pending set, the networks are loaded aside and only installed later by
+  /// NNUE::hot_swap().
 
-    useNNUE = Options["Use NNUE"];
-    if (!useNNUE)
-        return;
+  static void load_networks(string eval_file, string small_file, bool pending) {
 
-    string eval_file = string(Options["EvalFile"]);
-    if (eval_file.empty())
-        eval_file = EvalFileDefaultName;
+    string& evalFileName = pending ? pendingEvalFileName : currentEvalFileName;
+    string& evalFileSmallName = pending ? pendingEvalFileSmallName : currentEvalFileSmallName;
 
     #if defined(DEFAULT_NNUE_DIRECTORY)
     #define stringify2(x) #x
@@ -90,13 +95,13 @@ namespace Eval {
     #endif
 
     for (string directory : dirs)
-        if (currentEvalFileName != eval_file)
+        if (evalFileName != eval_file)
         {
             if (directory != "<internal>")
             {
                 ifstream stream(directory + eval_file, ios::binary);
-                if (load_eval(eval_file, stream))
-                    currentEvalFileName = eval_file;
+                if (NNUE::load_eval(eval_file, stream, NNUE::Big, pending))
+                    evalFileName = eval_file;
             }
 
             if (directory == "<internal>" && eval_file == EvalFileDefaultName)
@@ -111,16 +116,116 @@ namespace Eval {
                 (void) gEmbeddedNNUEEnd; // Silence warning on unused variable
 
                 istream stream(&buffer);
-                if (load_eval(eval_file, stream))
-                    currentEvalFileName = eval_file;
+                if (NNUE::load_eval(eval_file, stream, NNUE::Big, pending))
+                    evalFileName = eval_file;
             }
         }
+
+    // The small network is optional and never embedded. When it is available,
+    // it replaces the classical evaluation in lopsided positions.
+    if (small_file != "<empty>")
+        for (string directory : dirs)
+            if (evalFileSmallName != small_file && directory != "<internal>")
+            {
+                ifstream stream(directory + small_file, ios::binary);
+                if (NNUE::load_eval(small_file, stream, NNUE::Small, pending))
+                    evalFileSmallName = small_file;
+            }
+  }
+
+  /// NNUE::init() tries to load a NNUE network at startup time, or when the engine
+  /// receives a UCI command "setoption name EvalFile value nn-[a-z0-9]{12}.nnue"
+  /// The name of the NNUE network is always retrieved from the EvalFile option.
+
+  void NNUE::init(UCI::OptionsMap& options) {
+
+    useNNUE = options["Use NNUE"];
+    eagerUpdate = options["NNUE Eager Update"];
+    prefetchColumns = options["NNUE Prefetch"];
+    if (!useNNUE)
+        return;
+
+    string eval_file = string(options["EvalFile"]);
+    if (eval_file.empty())
+        eval_file = EvalFileDefaultName;
+
+    string small_file = string(options["EvalFileSmall"]);
+
+    // With "NNUE Hot Swap", networks that replace one already in use are loaded
+    // by a background thread, so that the UCI loop is not blocked. The engine
+    // keeps the current networks until the next 'go' installs the new ones.
+    if (options["NNUE Hot Swap"] && currentEvalFileName != "None")
+    {
+        finish_loading();
+        pendingEvalFileName = currentEvalFileName;
+        pendingEvalFileSmallName = currentEvalFileSmallName;
+        netLoader = std::thread(load_networks, eval_file, small_file, true);
+    }
+    else
+    {
+        finish_loading();
+        load_networks(eval_file, small_file, false);
+        pendingEvalFileName = currentEvalFileName;
+        pendingEvalFileSmallName = currentEvalFileSmallName;
+    }
+
+    // The small network in use is disabled at once when the option is cleared
+    // or changed, a new one being enabled when NNUE::hot_swap() installs it.
+    useSmallNNUE = currentEvalFileSmallName == small_file;
+  }
+
+  /// NNUE::finish_loading() waits for the background loading of networks, if any
+  void NNUE::finish_loading() {
+
+    if (netLoader.joinable())
+        netLoader.join();
+  }
+
+  /// NNUE::swap_pending() waits for the background loading of networks, if any,
+  /// and tells if there are networks to install with NNUE::hot_swap().
+
+  bool NNUE::swap_pending() {
+
+    finish_loading();
+
+    return   pendingEvalFileName != currentEvalFileName
+          || pendingEvalFileSmallName != currentEvalFileSmallName;
   }
 
-  /// NNUE::verify() verifies that the last net used was loaded successfully
-  void NNUE::verify() {
+  /// NNUE::hot_swap() installs the networks loaded in the background since the
+  /// last call, and returns true if there were some. Only pointers are swapped,
+  /// so the accumulators computed with the old networks must be marked as stale
+  /// by the caller. The networks are shared by all the engines of the process,
+  /// so none may be searching meanwhile, see Engine::hot_swap().
+
+  bool NNUE::hot_swap(UCI::OptionsMap& options) {
+
+    if (!swap_pending())
+        return false;
+
+    if (pendingEvalFileName != currentEvalFileName)
+    {
+        install_pending(Big);
+        currentEvalFileName = pendingEvalFileName;
+    }
+
+    if (pendingEvalFileSmallName != currentEvalFileSmallName)
+    {
+        install_pending(Small);
+        currentEvalFileSmallName = pendingEvalFileSmallName;
+    }
 
-    string eval_file = string(Options["EvalFile"]);
+    useSmallNNUE = currentEvalFileSmallName == string(options["EvalFileSmall"]);
+    return true;
+  }
+
+  /// NNUE::verify() verifies that the last net used was loaded successfully.
+  /// The status is reported to the engine the search is started on.
+  void NNUE::verify(Engine& engine) {
+
+    UCI::OptionsMap& options = engine.options;
+
+    string eval_file = string(options["EvalFile"]);
     if (eval_file.empty())
         eval_file = EvalFileDefaultName;
 
@@ -133,19 +238,29 @@ namespace Eval {
         string msg4 = "The default net can be downloaded from: https://tests.stockfishchess.org/api/nn/" + std::string(EvalFileDefaultName);
         string msg5 = "The engine will be terminated now.";
 
-        sync_cout << "info string ERROR: " << msg1 << sync_endl;
-        sync_cout << "info string ERROR: " << msg2 << sync_endl;
-        sync_cout << "info string ERROR: " << msg3 << sync_endl;
-        sync_cout << "info string ERROR: " << msg4 << sync_endl;
-        sync_cout << "info string ERROR: " << msg5 << sync_endl;
+        engine.output("info string ERROR: " + msg1);
+        engine.output("info string ERROR: " + msg2);
+        engine.output("info string ERROR: " + msg3);
+        engine.output("info string ERROR: " + msg4);
+        engine.output("info string ERROR: " + msg5);
 
         exit(EXIT_FAILURE);
     }
 
     if (useNNUE)
-        sync_cout << "info string NNUE evaluation using " << eval_file << " enabled" << sync_endl;
+        engine.output("info string NNUE evaluation using " + eval_file + " enabled");
     else
-        sync_cout << "info string classical evaluation enabled" << sync_endl;
+        engine.output("info string classical evaluation enabled");
+
+    string small_file = string(options["EvalFileSmall"]);
+    if (useNNUE && small_file != "<empty>")
+    {
+        if (useSmallNNUE)
+            engine.output("info string small NNUE evaluation using " + small_file + " enabled");
+        else
+            engine.output("info string WARNING: the small network " + small_file
+                          + " was not loaded, classical evaluation is used instead");
+    }
   }
 }
 
@@ -1045,6 +1160,28 @@ make_v:
 } // namespace Eval
 
 
+namespace {
+
+  // Deciding between classical and NNUE eval (~10 Elo): for high PSQ imbalance we use classical,
+  // but we switch to NNUE during long shuffling or with high material on the board.
+  bool lopsided(const Position& pos) {
+
+    return   (pos.count<ALL_PIECES>() > 7)
+          && abs(pos.psq_eg_stm()) * 5 > (856 + pos.non_pawn_material() / 64) * (10 + pos.rule50_count());
+  }
+
+} // namespace
+
+
+/// NNUE::net_size() returns the network evaluate() uses for the position, if
+/// it uses one, so that the eager update and the prefetch follow the same net.
+
+Eval::NNUE::NetSize Eval::NNUE::net_size(const Position& pos) {
+
+  return useSmallNNUE && lopsided(pos) ? Small : Big;
+}
+
+
 /// evaluate() is the evaluator for the outer world. It returns a static
 /// evaluation of the position from the point of view of the side to move.
 
@@ -1053,10 +1190,11 @@ Value Eval::evaluate(const Position& pos, int* complexity) {
   Value v;
   Color stm = pos.side_to_move();
   Value psq = pos.psq_eg_stm();
-  // Deciding between classical and NNUE eval (~10 Elo): for high PSQ imbalance we use classical,
-  // but we switch to NNUE during long shuffling or with high material on the board.
-  bool useClassical =    (pos.count<ALL_PIECES>() > 7)
-                      && abs(psq) * 5 > (856 + pos.non_pawn_material() / 64) * (10 + pos.rule50_count());
+  bool useClassical = lopsided(pos);
+
+  // When a small network is loaded, it is used instead of the classical eval
+  bool useSmallNet = useClassical && useNNUE && useSmallNNUE;
+  useClassical &= !useSmallNet;
 
   // Deciding between classical and NNUE eval (~10 Elo): for high PSQ imbalance we use classical,
   // but we switch to NNUE during long shuffling or with high material on the board.
@@ -1073,7 +1211,8 @@ Value Eval::evaluate(const Position& pos, int* complexity) {
        int scale = 1064 + 106 * pos.non_pawn_material() / 5120;
        Value optimism = pos.this_thread()->optimism[stm];
 
-       Value nnue = NNUE::evaluate(pos, true, &nnueComplexity);
+       Value nnue = useSmallNet ? NNUE::evaluate<NNUE::Small>(pos, true, &nnueComplexity)
+                                : NNUE::evaluate<NNUE::Big>(pos, true, &nnueComplexity);
        // Blend nnue complexity with (semi)classical complexity
        nnueComplexity = (104 * nnueComplexity + 131 * abs(nnue - psq)) / 256;
        if (complexity) // Return hybrid NNUE complexity to caller
@@ -1154,10 +1293,16 @@ std::string Eval::trace(Position& pos) {
   ss << "\nClassical evaluation   " << to_cp(v) << " (white side)\n";
   if (Eval::useNNUE)
   {
-      v = NNUE::evaluate(pos, false);
+      v = NNUE::evaluate<NNUE::Big>(pos, false);
       v = pos.side_to_move() == WHITE ? v : -v;
       ss << "NNUE evaluation        " << to_cp(v) << " (white side)\n";
   }
+  if (Eval::useNNUE && Eval::useSmallNNUE)
+  {
+      v = NNUE::evaluate<NNUE::Small>(pos, false);
+      v = pos.side_to_move() == WHITE ? v : -v;
+      ss << "Small NNUE evaluation  " << to_cp(v) << " (white side)\n";
+  }
 
   v = evaluate(pos);
   v = pos.side_to_move() == WHITE ? v : -v;
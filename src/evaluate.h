@@ -21,12 +21,16 @@
 
 #include <string>
 #include <optional>
+#include <vector>
 
 #include "types.h"
+#include "uci.h"
 
 namespace Stockfish {
 
+class Engine;
 class Position;
+class Thread;
 
 namespace Eval {
 
@@ -34,7 +38,9 @@ namespace Eval {
   Value evaluate(const Position& pos, int* complexity = nullptr);
 
   extern bool useNNUE;
+  extern bool useSmallNNUE;
   extern std::string currentEvalFileName;
+  extern std::string currentEvalFileSmallName;
 
   // The default net name MUST follow the format nn-[SHA256 first 12 digits].nnue
   // for the build process (profile-build and fishtest) to work. Do not change the
@@ -43,15 +49,34 @@ namespace Eval {
 
   namespace NNUE {
 
+    // The main network, and the optional small one used in lopsided positions
+    enum NetSize : int { Big, Small };
+
     std::string trace(Position& pos);
+    template<NetSize Net>
     Value evaluate(const Position& pos, bool adjusted = false, int* complexity = nullptr);
+    template<NetSize Net>
+    Value evaluate_psqt(const Position& pos);
+
+    void init(UCI::OptionsMap& options);
+    void verify(Engine& engine);
+    bool swap_pending();
+    bool hot_swap(UCI::OptionsMap& options);
+    void finish_loading();
+
+    NetSize net_size(const Position& pos);
+
+    extern bool eagerUpdate;
+    void update_eager(const Position& pos);
+    extern bool prefetchColumns;
+    void prefetch_columns(const Position& pos);
 
-    void init();
-    void verify();
+    void benchmark(Thread* th, const std::vector<std::string>& fens, int iterations);
 
-    bool load_eval(std::string name, std::istream& stream);
+    bool load_eval(std::string name, std::istream& stream, NetSize net = Big, bool pending = false);
+    void install_pending(NetSize net);
     bool save_eval(std::ostream& stream);
-    bool save_eval(const std::optional<std::string>& filename);
+    bool save_eval(const std::optional<std::string>& filename, bool compact = false);
 
   } // namespace NNUE
 
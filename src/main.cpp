@@ -20,12 +20,9 @@
 
 #include "bitboard.h"
 #include "endgame.h"
+#include "engine.h"
 #include "position.h"
 #include "psqt.h"
-#include "search.h"
-#include "syzygy/tbprobe.h"
-#include "thread.h"
-#include "tt.h"
 #include "uci.h"
 
 using namespace Stockfish;
@@ -35,19 +32,17 @@ int main(int argc, char* argv[]) {
   std::cout << engine_info() << std::endl;
 
   CommandLine::init(argc, argv);
-  UCI::init(Options);
-  Tune::init();
+  Engine engine;
+  Tune::init(engine.options);
   PSQT::init();
   Bitboards::init();
   Position::init();
   Bitbases::init();
   Endgames::init();
-  Threads.set(size_t(Options["Threads"]));
-  Search::clear(); // After threads are up
-  Eval::NNUE::init();
+  Eval::NNUE::init(engine.options);
 
-  UCI::loop(argc, argv);
+  UCI::loop(engine, argc, argv);
 
-  Threads.set(0);
+  Eval::NNUE::finish_loading();
   return 0;
 }
@@ -0,0 +1,833 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "engine.h"
+#include "mcts.h"
+#include "movepick.h"
+#include "search.h"
+#include "thread.h"
+#include "tt.h"
+#include "uci.h"
+
+namespace Stockfish {
+
+namespace MCTS {
+
+namespace {
+
+  // Scale of the logistic function turning a value into a winning probability,
+  // a pawn up being worth about 64%.
+  constexpr double ValueScale = 360.0;
+
+  // The priors of the root moves are a softmax of their winning probabilities
+  // found in the TT, with this temperature.
+  constexpr double PriorTemperature = 0.1;
+
+  // The priors of the other moves decrease geometrically with their rank in
+  // the MovePicker order, by this factor.
+  constexpr double PriorDecay = 0.85;
+
+  // Progressive widening: a node with n playouts has up to 2 + 2 * sqrt(n)
+  // edges. The MovePicker sorts the quiet moves as at a high depth.
+  constexpr int WideningBase = 2;
+  constexpr double WideningFactor = 2.0;
+  constexpr Depth WideningDepth = Depth(MAX_PLY);
+
+  // First play urgency: an unvisited child is valued as its parent, minus this
+  constexpr double FpuReduction = 0.1;
+
+  // Beyond this depth the leaves are evaluated without being expanded
+  constexpr int MaxTreeDepth = 128;
+
+  double to_probability(Value v) {
+    return 1.0 / (1.0 + std::exp(-double(v) / ValueScale));
+  }
+
+  Value to_value(double q) {
+    q = std::clamp(q, 0.001, 0.999);
+    return Value(int(std::lround(ValueScale * std::log(q / (1.0 - q)))));
+  }
+
+  // mean() is the average value of the playouts through an edge, the virtual
+  // losses of the playouts in progress counting as lost ones, or through a node.
+  double mean(const Edge& e, double fpu) {
+    uint32_t visits = e.visits + e.virtualLoss;
+    return visits ? double(e.valueSum) / ValueUnit / visits : fpu;
+  }
+
+  double mean(const Node* n) {
+    uint32_t visits = n->visits;
+    return visits ? double(n->valueSum) / ValueUnit / visits : 0.5;
+  }
+
+  template<typename T>
+  void add(T* stats, double q) {
+    stats->valueSum += uint64_t(q * ValueUnit);
+    stats->visits++;
+  }
+
+  // path_key() is the key of a child in a plain tree, which depends on the key
+  // of its parent and on the move instead of the position.
+  Key path_key(Key parent, Move m) {
+    Key k = (parent ^ (uint64_t(m) * 0x9E3779B97F4A7C15ULL)) * 0xBF58476D1CE4E5B9ULL;
+    return k ^ (k >> 31);
+  }
+
+  int widening_target(uint32_t visits) {
+    return std::min(WideningBase + int(WideningFactor * std::sqrt(double(visits))), 255);
+  }
+
+  // most_visited() returns the edge of a node with the most playouts, if any
+  const Edge* most_visited(const NodeTable& table, Node* n) {
+
+    const Edge* best = nullptr;
+
+    if (!n || n->state.load(std::memory_order_acquire) != EXPANDED)
+        return best;
+
+    table.for_each_edge(n, [&](const Edge& e) {
+        if (e.visits && (!best || e.visits > best->visits))
+            best = &e;
+    });
+
+    return best;
+  }
+
+} // namespace
+
+
+/// NodeTable::resize() sets the size of the table in megabytes. The memory is
+/// only allocated and cleared when it changes, before the first search with
+/// MCTS, so that the table costs nothing to the searches without it.
+
+void NodeTable::resize(size_t mb) {
+
+  if (mb == mbSize)
+      return;
+
+  aligned_large_pages_free(table);
+
+  aligned_large_pages_free(blocks);
+
+  mbSize = mb;
+  clusterCount = mbSize * 1024 * 1024 * 3 / 4 / sizeof(Cluster);
+  blockCount = uint32_t(std::min(mbSize * 1024 * 1024 / 4 / sizeof(EdgeBlock), size_t(UINT32_MAX)));
+  table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
+  blocks = static_cast<EdgeBlock*>(aligned_large_pages_alloc(blockCount * sizeof(EdgeBlock)));
+
+  if (!table || !blocks)
+  {
+      std::cerr << "Failed to allocate " << mbSize
+                << "MB for the MCTS node table." << std::endl;
+      exit(EXIT_FAILURE);
+  }
+
+  std::memset(static_cast<void*>(table), 0, clusterCount * sizeof(Cluster));
+  std::memset(static_cast<void*>(blocks), 0, blockCount * sizeof(EdgeBlock));
+}
+
+
+/// NodeTable::new_search() starts a new generation of nodes. The nodes of the
+/// previous searches are treated as empty, so all the edge blocks are free.
+/// When the generation wraps around, the table is cleared, since the nodes of
+/// the search 255 generations ago would otherwise be taken as current ones.
+
+void NodeTable::new_search() {
+
+  if (generation8 == 255)
+      std::memset(static_cast<void*>(table), 0, clusterCount * sizeof(Cluster));
+
+  generation8 = uint8_t(generation8 % 255 + 1);
+  inserted = recycled = 0;
+  blocksUsed = 1;
+  freeBlocks.clear();
+}
+
+
+/// NodeTable::find() returns the node of the current search with the given
+/// key, or nullptr if there is none.
+
+Node* NodeTable::find(Key key) const {
+
+  Node* const n = cluster(key).node;
+
+  for (int i = 0; i < ClusterSize; ++i)
+      if (n[i].key.load(std::memory_order_acquire) == key && n[i].generation == generation8)
+          return &n[i];
+
+  return nullptr;
+}
+
+
+/// NodeTable::acquire() marks a node found without the lock of its cluster as
+/// in use, and returns false if it is not the node of the key anymore. The
+/// key is checked after the increment, and the recycler clears the key before
+/// checking the count, so that either the node is seen in use by the recycler
+/// or its new key is seen here.
+
+bool NodeTable::acquire(Node* n, Key key) const {
+
+  n->inUse.fetch_add(1);
+
+  if (n->key.load() == key && n->generation == generation8)
+      return true;
+
+  n->inUse.fetch_sub(1);
+  return false;
+}
+
+
+/// NodeTable::find_or_insert() returns the node with the given key, marked as
+/// in use until release() is called. It is created if it is not in the table
+/// yet, in place of the node of an older search or of the least visited node
+/// of the cluster. The nodes in use and the pinned one, the root, are never
+/// replaced, and nullptr is returned when no node of the cluster can be.
+
+Node* NodeTable::find_or_insert(Key key, const Node* pinned, bool& found) {
+
+  Node* n = find(key);
+
+  if ((found = n && acquire(n, key)))
+      return n;
+
+  Cluster& c = cluster(key);
+
+  while (c.lock.exchange(true, std::memory_order_acquire))
+      std::this_thread::yield();
+
+  // Another thread may have inserted the node meanwhile. No node is recycled
+  // while the cluster is locked, so it can be acquired.
+  if ((n = find(key)) != nullptr && acquire(n, key))
+  {
+      c.lock.store(false, std::memory_order_release);
+      found = true;
+      return n;
+  }
+
+  bool tried[ClusterSize] = {};
+  n = nullptr;
+
+  while (!n)
+  {
+      int64_t minVisits = INT64_MAX;
+      int best = -1;
+
+      for (int i = 0; i < ClusterSize; ++i)
+      {
+          Node* candidate = &c.node[i];
+          int64_t v = candidate->generation != generation8 ? -1 : int64_t(candidate->visits);
+
+          if (v < minVisits && !tried[i] && candidate != pinned && !candidate->inUse)
+          {
+              minVisits = v;
+              best = i;
+          }
+      }
+
+      if (best < 0)
+          break;
+
+      // The key is cleared before the count is checked, see acquire(), so
+      // that no thread trusts the node while it is being reset.
+      Node* candidate = &c.node[best];
+      Key oldKey = candidate->key;
+      candidate->key.store(0);
+      tried[best] = true;
+
+      if (candidate->inUse.load())
+      {
+          candidate->key.store(oldKey);
+          continue;
+      }
+
+      n = candidate;
+
+      if (minVisits >= 0)
+      {
+          free_blocks(n);
+          recycled++;
+      }
+  }
+
+  if (n)
+  {
+      n->visits = 0;
+      n->valueSum = 0;
+      n->edgeCount = 0;
+      n->block = 0;
+      n->terminal = n->exhausted = false;
+      n->state = UNEXPANDED;
+      n->generation = generation8;
+      n->inUse = 1;
+      n->key.store(key, std::memory_order_release);
+      inserted++;
+  }
+
+  c.lock.store(false, std::memory_order_release);
+  return n;
+}
+
+
+/// NodeTable::add_edge() returns the place of the next edge of a node, which
+/// is in a new edge block when the previous ones are full, or nullptr if the
+/// node has the maximum number of edges or the pool is empty. The caller must
+/// be the only thread that adds edges to the node, and increments edgeCount
+/// once the edge is set.
+
+Edge* NodeTable::add_edge(Node* n) {
+
+  int count = n->edgeCount;
+
+  if (count < InlineEdges)
+      return &n->edges[count];
+
+  if (count == 255)
+      return nullptr;
+
+  int idx = count - InlineEdges;
+  uint32_t last = 0;
+
+  for (uint32_t b = n->block; b; b = blocks[b].next)
+  {
+      if (idx < BlockEdges)
+          return &blocks[b].edges[idx];
+
+      idx -= BlockEdges;
+      last = b;
+  }
+
+  uint32_t b = 0;
+
+  while (poolLock.exchange(true, std::memory_order_acquire))
+      std::this_thread::yield();
+
+  if (!freeBlocks.empty())
+  {
+      b = freeBlocks.back();
+      freeBlocks.pop_back();
+  }
+  else if (blocksUsed < blockCount)
+      b = blocksUsed++;
+
+  poolLock.store(false, std::memory_order_release);
+
+  if (!b)
+      return nullptr;
+
+  blocks[b].next = 0;
+
+  if (last)
+      blocks[last].next = b;
+  else
+      n->block = b;
+
+  return &blocks[b].edges[0];
+}
+
+
+/// NodeTable::free_blocks() gives the edge blocks of a node back to the pool
+
+void NodeTable::free_blocks(Node* n) {
+
+  int count = n->edgeCount - InlineEdges;
+
+  while (poolLock.exchange(true, std::memory_order_acquire))
+      std::this_thread::yield();
+
+  for (uint32_t b = n->block; count > 0 && b && b < blockCount; b = blocks[b].next, count -= BlockEdges)
+      freeBlocks.push_back(b);
+
+  poolLock.store(false, std::memory_order_release);
+}
+
+
+/// Tree::new_search() decides if the search of the main thread is done with
+/// MCTS, and builds the root of a new graph from the root moves in that case.
+/// It is called before the other threads are started.
+
+void Tree::new_search(Thread& mainThread) {
+
+  Engine& engine = mainThread.engine;
+
+  isActive =   engine.options["MCTS"]
+            && !engine.limits.depth
+            && !engine.limits.mate
+            && !mainThread.rootMoves.empty();
+
+  if (!isActive)
+      return;
+
+  transpositions = engine.options["MCTS Transpositions"];
+  leafDepth = Depth(int(engine.options["MCTS Leaf Depth"]));
+  exploration = int(engine.options["MCTS Exploration"]) / 100.0;
+  playouts = edgeCount = transpositionHits = savedEvaluations = collisions = 0;
+  maxDepth = 0;
+
+  std::vector<Move> moves;
+  for (const auto& rm : mainThread.rootMoves)
+      moves.push_back(rm.pv[0]);
+
+  bool found;
+  table.resize(size_t(engine.options["MCTS Hash"]));
+  table.new_search();
+  root = table.find_or_insert(mainThread.rootPos.key(), nullptr, found);
+  expand(mainThread.rootPos, root, moves);
+  root->state = EXPANDED;
+
+  // The root is pinned instead of being in use, see find_or_insert()
+  table.release(root);
+}
+
+
+/// Tree::clear() ends the search with MCTS. The nodes stay in the table until
+/// they are replaced by those of the next searches.
+
+void Tree::clear() {
+
+  isActive = false;
+}
+
+
+/// Tree::expand() creates the edges of the root for all the root moves. The
+/// priors come from the values that the alpha-beta searches left in the TT
+/// for the children, the ones without such a value getting the prior of the
+/// worst child that has one.
+
+void Tree::expand(Position& pos, Node* node, const std::vector<Move>& moves) {
+
+  TranspositionTable& tt = pos.this_thread()->engine.tt;
+  std::vector<double> q(moves.size(), -1.0);
+  double qMin = 1.0, qMax = 0.0;
+
+  for (size_t i = 0; i < moves.size(); ++i)
+  {
+      bool found;
+      TTEntry* tte = tt.probe(pos.key_after(moves[i]), found);
+
+      if (found && tte->value() != VALUE_NONE)
+      {
+          q[i] = 1.0 - to_probability(tte->value());
+          qMin = std::min(qMin, q[i]);
+          qMax = std::max(qMax, q[i]);
+      }
+  }
+
+  std::vector<std::pair<double, Move>> weights;
+  for (size_t i = 0; i < moves.size(); ++i)
+      weights.emplace_back(qMax < qMin ? 1.0 : std::exp(((q[i] < 0 ? qMin : q[i]) - qMax) / PriorTemperature),
+                           moves[i]);
+
+  std::stable_sort(weights.begin(), weights.end(),
+                   [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  double sum = 0;
+  for (const auto& w : weights)
+      sum += w.first;
+
+  for (const auto& w : weights)
+  {
+      Edge* e = table.add_edge(node);
+      if (!e)
+          break;
+
+      e->move = w.second;
+      e->prior = float(w.first / sum);
+      e->visits = e->virtualLoss = 0;
+      e->valueSum = 0;
+      node->edgeCount.fetch_add(1, std::memory_order_release);
+      edgeCount++;
+  }
+
+  node->terminal = moves.empty();
+  node->exhausted = true;
+}
+
+
+/// Tree::widen() adds edges to a node until it has the given number of them,
+/// for the first legal moves of a MovePicker that are not already edges: the
+/// TT move, the good captures, the quiet moves sorted by history and then the
+/// bad captures. There are no killers, since the graph has no search stack.
+/// So the moves that are never searched take no memory, and a new leaf is
+/// expanded without scoring all its moves. The caller must be the only thread
+/// that adds edges to the node, and must hold it in use so that it is not
+/// recycled meanwhile.
+
+void Tree::widen(Position& pos, Node* node, int target) {
+
+  Thread* th = pos.this_thread();
+  bool ttHit;
+  TTEntry* tte = th->engine.tt.probe(pos.key(), ttHit);
+  Move ttMove = ttHit ? tte->move() : MOVE_NONE;
+  const PieceToHistory* sentinel = &th->continuationHistory[0][0][NO_PIECE][0];
+  const PieceToHistory* contHist[] = { sentinel, sentinel, nullptr, sentinel, nullptr, sentinel };
+  Move killers[2] = { MOVE_NONE, MOVE_NONE };
+
+  MovePicker mp(pos, ttMove, WideningDepth, &th->mainHistory, &th->captureHistory,
+                contHist, MOVE_NONE, killers);
+
+  int count = node->edgeCount;
+  Move m;
+
+  while (count < target)
+  {
+      if ((m = mp.next_move()) == MOVE_NONE)
+      {
+          node->exhausted = true;
+          break;
+      }
+
+      if (!pos.legal(m))
+          continue;
+
+      bool present = false;
+      table.for_each_edge(node, [&](const Edge& e) { present |= e.move == m; });
+
+      Edge* e;
+      if (present || !(e = table.add_edge(node)))
+          continue;
+
+      e->move = m;
+      e->prior = float((1 - PriorDecay) * std::pow(PriorDecay, count));
+      e->visits = e->virtualLoss = 0;
+      e->valueSum = 0;
+      node->edgeCount.store(uint8_t(++count), std::memory_order_release);
+      edgeCount++;
+  }
+}
+
+
+/// Tree::select() returns the edge of an expanded node that maximizes the PUCT
+/// formula: the mean value of the edge plus an exploration term, which grows
+/// with the prior of the edge and shrinks with its number of playouts.
+
+Edge* Tree::select(Node* node) {
+
+  uint32_t total = 0;
+  table.for_each_edge(node, [&](const Edge& e) { total += e.visits + e.virtualLoss; });
+
+  double sqrtVisits = std::sqrt(double(std::max(total, 1U)));
+  double fpu = node->visits ? 1.0 - mean(node) - FpuReduction : 0.5;
+  double bestScore = -1.0;
+  Edge* best = nullptr;
+
+  table.for_each_edge(node, [&](Edge& e) {
+      double score =  mean(e, fpu)
+                    + exploration * e.prior * sqrtVisits / (1 + e.visits + e.virtualLoss);
+
+      if (score > bestScore)
+      {
+          bestScore = score;
+          best = &e;
+      }
+  });
+
+  return best;
+}
+
+
+/// Tree::playout() walks the graph from the root down to a leaf, expands and
+/// evaluates the leaf, and adds its value to the edges and nodes of the path.
+/// The walk also stops at a child that has more playouts than the edge that
+/// leads to it, reached by other paths, whose mean value is then used instead
+/// of a new evaluation. playout() returns false when the leaf was being
+/// expanded by another thread, when no node could be found or inserted for
+/// a child, or when the search was stopped during the evaluation, in which
+/// case nothing is added. The nodes of the path are in use until the end of
+/// the playout, so they are not recycled meanwhile.
+
+bool Tree::playout(Thread& th, std::vector<StateInfo>& states) {
+
+  Position& pos = th.rootPos;
+  Node* nodes[MaxTreeDepth + 1];
+  Key keys[MaxTreeDepth + 1];
+  Edge* edges[MaxTreeDepth];
+  Move moves[MaxTreeDepth];
+  Node* node = root;
+  bool updateLeaf = true;
+  double q; // For the side that moved into the leaf
+  int ply = 0;
+
+  auto unwind = [&]() {
+      for (int i = ply; i > 0; --i)
+      {
+          if (nodes[i])
+              table.release(nodes[i]);
+
+          edges[i - 1]->virtualLoss--;
+          pos.undo_move(moves[i - 1]);
+      }
+  };
+
+  nodes[0] = node;
+  keys[0] = node->key;
+
+  while (true)
+  {
+      if (node->terminal)
+      {
+          q = 1.0 - to_probability(pos.checkers() ? -VALUE_MATE : VALUE_DRAW);
+          break;
+      }
+
+      if (node->state.load(std::memory_order_acquire) != EXPANDED)
+      {
+          uint8_t expected = UNEXPANDED;
+          if (!node->state.compare_exchange_strong(expected, EXPANDING))
+          {
+              collisions++;
+              unwind();
+              return false;
+          }
+
+          Value v = Search::leaf_search(pos, leafDepth);
+
+          if (th.engine.threads.stop)
+          {
+              node->state = UNEXPANDED;
+              unwind();
+              return false;
+          }
+
+          widen(pos, node, widening_target(0));
+          node->terminal = node->exhausted && !node->edgeCount;
+          node->state.store(EXPANDED, std::memory_order_release);
+          q = 1.0 - to_probability(v);
+          break;
+      }
+
+      if (ply == MaxTreeDepth)
+      {
+          q = 1.0 - to_probability(Search::leaf_search(pos, leafDepth));
+          break;
+      }
+
+      // The node is the root or is in use by this playout, so it cannot be
+      // recycled while the edges are added.
+      int target = widening_target(node->visits);
+
+      if (   !node->exhausted
+          &&  node->edgeCount < target
+          && !node->widening.exchange(true))
+      {
+          widen(pos, node, target);
+          node->widening = false;
+      }
+
+      Edge* e = select(node);
+      Move m = e ? Move(e->move) : MOVE_NONE;
+
+      if (!e || !pos.pseudo_legal(m) || !pos.legal(m))
+      {
+          collisions++;
+          unwind();
+          return false;
+      }
+
+      e->virtualLoss++;
+      edges[ply] = e;
+      moves[ply] = m;
+      pos.do_move(m, states[ply]);
+
+      bool found;
+      Key childKey = transpositions ? pos.key() : path_key(keys[ply], m);
+      Node* child = table.find_or_insert(childKey, root, found);
+
+      if (found && !e->visits)
+          transpositionHits++;
+
+      nodes[++ply] = child;
+
+      if (!child)
+      {
+          collisions++;
+          unwind();
+          return false;
+      }
+
+      node = child;
+      keys[ply] = childKey;
+
+      // A draw by repetition or by the 50 moves rule depends on the path, so
+      // it is only added to the edge.
+      if (pos.is_draw(ply))
+      {
+          q = 0.5;
+          updateLeaf = false;
+          break;
+      }
+
+      if (transpositions && child->visits > e->visits)
+      {
+          q = mean(child);
+          updateLeaf = false;
+          savedEvaluations++;
+          break;
+      }
+  }
+
+  if (ply > maxDepth)
+      maxDepth = ply;
+
+  if (updateLeaf)
+      add(nodes[ply], q);
+
+  for (int i = ply - 1; i >= 0; --i)
+  {
+      add(edges[i], q);
+      q = 1.0 - q;
+      add(nodes[i], q);
+  }
+
+  unwind();
+  playouts++;
+  return true;
+}
+
+
+/// Tree::search() is the search loop of a thread with MCTS, which runs the
+/// playouts until the search is stopped. The main thread also manages the
+/// time and sends the PV when the best move changes, and once per second.
+
+void Tree::search(Thread& th) {
+
+  Engine& engine = th.engine;
+  ThreadPool& threads = engine.threads;
+  MainThread* mainThread = (&th == threads.main() ? threads.main() : nullptr);
+  std::vector<StateInfo> states(MaxTreeDepth);
+  TimePoint lastOutput = 0;
+  Move lastBestMove = MOVE_NONE;
+
+  while (!threads.stop)
+  {
+      if (!playout(th, states))
+          std::this_thread::yield();
+
+      if (!mainThread)
+          continue;
+
+      mainThread->check_time();
+
+      TimePoint elapsed = engine.time.elapsed();
+
+      if (    engine.limits.use_time_management()
+          && !mainThread->stopOnPonderhit
+          &&  elapsed > engine.time.optimum())
+      {
+          // If we are allowed to ponder do not stop the search now but
+          // keep pondering until the GUI sends "ponderhit" or "stop".
+          if (mainThread->ponder)
+              mainThread->stopOnPonderhit = true;
+          else
+              threads.stop = true;
+      }
+
+      const Edge* best = most_visited(table, root);
+
+      if (   best
+          && (best->move != lastBestMove || elapsed - lastOutput >= 1000)
+          && engine.info_allowed())
+      {
+          lastBestMove = best->move;
+          lastOutput = elapsed;
+          update_root_moves(th);
+          engine.output(UCI::pv(th.rootPos, th.completedDepth, -VALUE_INFINITE, VALUE_INFINITE));
+      }
+  }
+
+  if (!mainThread)
+      return;
+
+  update_root_moves(th);
+
+  if (engine.info_allowed())
+      engine.output(UCI::pv(th.rootPos, th.completedDepth, -VALUE_INFINITE, VALUE_INFINITE));
+
+  engine.output("info string MCTS playouts " + std::to_string(playouts)
+                + " playouts/second " + std::to_string(playouts * 1000 / (engine.time.elapsed() + 1))
+                + " nodes " + std::to_string(table.size())
+                + " recycled " + std::to_string(table.recycled_nodes())
+                + " edges " + std::to_string(edgeCount)
+                + " transpositions " + std::to_string(transpositionHits)
+                + " evaluations saved " + std::to_string(savedEvaluations)
+                + " collisions " + std::to_string(collisions));
+}
+
+
+/// Tree::update_root_moves() sets the scores and PVs of the root moves of the
+/// main thread from the graph, sorted by number of playouts, so that they are
+/// reported and played as those of the iterative deepening.
+
+void Tree::update_root_moves(Thread& mainThread) {
+
+  Search::RootMoves& rootMoves = mainThread.rootMoves;
+  Position& pos = mainThread.rootPos;
+  std::vector<StateInfo> states(MAX_PLY);
+
+  auto visits = [&](Move m) {
+      uint32_t v = 0;
+      table.for_each_edge(root, [&](const Edge& e) { if (e.move == m) v = e.visits; });
+      return v;
+  };
+
+  table.for_each_edge(root, [&](const Edge& e) {
+      Search::RootMove& rm = *std::find(rootMoves.begin(), rootMoves.end(), e.move);
+
+      rm.previousScore = rm.score;
+      rm.score = rm.averageScore = e.visits ? to_value(mean(e, 0)) : -VALUE_INFINITE;
+      rm.selDepth = maxDepth + leafDepth;
+      rm.pv.resize(1);
+
+      // The graph may have cycles, so the length of the PV is limited. The
+      // moves are checked since the nodes may be recycled meanwhile.
+      Key key = root->key;
+      for (Move m = e.move; ; )
+      {
+          pos.do_move(m, states[rm.pv.size() - 1]);
+          key = transpositions ? pos.key() : path_key(key, m);
+
+          const Edge* c = most_visited(table, table.find(key));
+          if (   !c
+              || rm.pv.size() >= MAX_PLY
+              || !pos.pseudo_legal(m = c->move)
+              || !pos.legal(m))
+              break;
+
+          rm.pv.push_back(m);
+      }
+
+      for (auto it = rm.pv.rbegin(); it != rm.pv.rend(); ++it)
+          pos.undo_move(*it);
+  });
+
+  std::stable_sort(rootMoves.begin(), rootMoves.end(),
+                   [&](const Search::RootMove& a, const Search::RootMove& b) {
+                       return visits(a.pv[0]) > visits(b.pv[0]);
+                   });
+
+  mainThread.rootDepth = mainThread.completedDepth = Depth(rootMoves[0].pv.size());
+}
+
+} // namespace MCTS
+
+} // namespace Stockfish
@@ -0,0 +1,187 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MCTS_H_INCLUDED
+#define MCTS_H_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "misc.h"
+#include "position.h"
+#include "types.h"
+
+namespace Stockfish {
+
+class Thread;
+
+namespace MCTS {
+
+/// Node is a node of the search graph of the Monte Carlo tree search. With
+/// transpositions, there is one node per position, shared by all the paths
+/// that reach it, so its statistics merge those of all these paths: number
+/// of playouts and sum of their values, as winning probabilities for the side
+/// that made the move leading to the node, in units of 1 / ValueUnit. The
+/// edges are added a few at a time as the node gets more playouts, see
+/// Tree::widen(). The first ones are stored in the node and the next ones in
+/// a chain of edge blocks. A node counts the playouts that have it on their
+/// path, and is not recycled for another position until they are done with
+/// it. The lookups that do not hold a node, as for the PV, check its key and
+/// the legality of its moves before trusting what they read from it.
+
+enum NodeState : uint8_t { UNEXPANDED, EXPANDING, EXPANDED };
+
+constexpr uint64_t ValueUnit = 1 << 16;
+
+constexpr int InlineEdges = 4;
+constexpr int BlockEdges = 12;
+
+/// Edge is a move of an expanded node. It has its own statistics, for the
+/// side to move at the node, since the child may be reached by other paths,
+/// and draws by repetition depend on the path. The child is looked up in the
+/// node table by its key each time the edge is followed.
+
+struct Edge {
+  std::atomic<Move> move;
+  std::atomic<float> prior;
+  std::atomic<uint32_t> visits;
+  std::atomic<uint32_t> virtualLoss;
+  std::atomic<uint64_t> valueSum;
+};
+
+struct Node {
+  std::atomic<Key> key;
+  std::atomic<uint64_t> valueSum;
+  std::atomic<uint32_t> visits;
+  std::atomic<uint32_t> block;  // First edge block, 0 if none
+  std::atomic<uint8_t> state;
+  std::atomic<uint8_t> generation;
+  std::atomic<uint8_t> edgeCount;
+  std::atomic<bool> terminal;   // No legal moves
+  std::atomic<bool> exhausted;  // All the legal moves have an edge
+  std::atomic<bool> widening;   // A thread is adding edges
+  std::atomic<uint16_t> inUse;  // Playouts with the node on their path
+  Edge edges[InlineEdges];
+};
+
+struct EdgeBlock {
+  std::atomic<uint32_t> next;
+  Edge edges[BlockEdges];
+};
+
+
+/// NodeTable is the arena of the nodes, a hash table of clusters of nodes with
+/// a fixed size set by the "MCTS Hash" option, so that the memory used by a
+/// search is bounded however long it runs. Looking up a node takes no lock.
+/// A new node takes the place of the least visited node of its cluster, which
+/// is usually a leaf far from the root, or of a node of a previous search,
+/// but never of a node on the path of a playout. Only the cluster is locked
+/// meanwhile, so the threads go on searching while the nodes are recycled. A quarter of the memory holds a pool of edge blocks,
+/// which go back to the pool with their node.
+
+class NodeTable {
+
+  static constexpr int ClusterSize = 4;
+
+  struct Cluster {
+    std::atomic<bool> lock;
+    Node node[ClusterSize];
+  };
+
+public:
+ ~NodeTable() { aligned_large_pages_free(table); aligned_large_pages_free(blocks); }
+  void resize(size_t mbSize);
+  void new_search();
+  Node* find(Key key) const;
+  Node* find_or_insert(Key key, const Node* pinned, bool& found);
+  void release(Node* n) { n->inUse.fetch_sub(1); }
+  Edge* add_edge(Node* node);
+  uint64_t size() const { return inserted; }
+  uint64_t recycled_nodes() const { return recycled; }
+
+  // for_each_edge() calls f on the edges of a node, the walk of the chain of
+  // edge blocks being bounded in case the node is recycled meanwhile.
+  template<typename F>
+  void for_each_edge(Node* n, F&& f) const {
+    int count = n->edgeCount.load(std::memory_order_acquire);
+    for (int i = 0; i < std::min(count, InlineEdges); ++i)
+        f(n->edges[i]);
+
+    for (uint32_t b = n->block; count > InlineEdges && b && b < blockCount; b = blocks[b].next)
+        for (int i = 0; i < BlockEdges && count > InlineEdges; ++i, --count)
+            f(blocks[b].edges[i]);
+  }
+
+private:
+  Cluster& cluster(Key key) const { return table[mul_hi64(key, clusterCount)]; }
+  bool acquire(Node* n, Key key) const;
+  void free_blocks(Node* n);
+
+  size_t clusterCount = 0;
+  size_t mbSize = 0;
+  Cluster* table = nullptr;
+  EdgeBlock* blocks = nullptr;
+  uint32_t blockCount = 0;
+  uint32_t blocksUsed; // Blocks 1 to blocksUsed - 1 have been handed out once
+  std::vector<uint32_t> freeBlocks;
+  std::atomic<bool> poolLock{false};
+  uint8_t generation8 = 0; // Never 0 during a search, which is the value of the empty nodes
+  std::atomic<uint64_t> inserted{0}, recycled{0};
+};
+
+
+/// Tree is the shared search graph of the threads of an engine. When the
+/// "MCTS" option is set, new_search() builds the root before the threads
+/// start, and each thread then runs search() instead of the iterative
+/// deepening loop. The graph is walked with PUCT and each new leaf is
+/// evaluated with a short alpha-beta search, see Search::leaf_search().
+/// Without "MCTS Transpositions" the nodes are keyed by their path instead of
+/// their position, which makes a plain tree.
+
+class Tree {
+
+public:
+  void new_search(Thread& mainThread);
+  void search(Thread& th);
+  void clear();
+  bool active() const { return isActive; }
+
+private:
+  bool playout(Thread& th, std::vector<StateInfo>& states);
+  void expand(Position& pos, Node* node, const std::vector<Move>& moves);
+  void widen(Position& pos, Node* node, int target);
+  Edge* select(Node* node);
+  void update_root_moves(Thread& mainThread);
+
+  NodeTable table;
+  Node* root;
+  bool isActive = false;
+  bool transpositions;
+  Depth leafDepth;
+  double exploration;
+  std::atomic<uint64_t> playouts, edgeCount, transpositionHits, savedEvaluations, collisions;
+  std::atomic<int> maxDepth;
+};
+
+} // namespace MCTS
+
+} // namespace Stockfish
+
+#endif // #ifndef MCTS_H_INCLUDED
@@ -26,6 +26,8 @@
 #define NOMINMAX
 #endif
 
+#include <fcntl.h>
+#include <io.h>
 #include <windows.h>
 // The needed Windows API for processor groups could be missed from old Windows
 // versions, so instead of calling them directly (forcing the linker to resolve
@@ -41,16 +43,22 @@ typedef WORD(*fun5_t)();
 }
 #endif
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include <cstdlib>
 
 #if defined(__linux__) && !defined(__ANDROID__)
+#include <linux/perf_event.h>
 #include <stdlib.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 
 #if defined(__APPLE__) || defined(__ANDROID__) || defined(__OpenBSD__) || (defined(__GLIBCXX__) && !defined(_GLIBCXX_HAVE_ALIGNED_ALLOC) && !defined(_WIN32)) || defined(__e2k__)
@@ -299,27 +307,216 @@ void dbg_print() {
 }
 
 
+namespace {
+
 /// Used to serialize access to std::cout to avoid multiple threads writing at
 /// the same time.
 
-std::ostream& operator<<(std::ostream& os, SyncCout sc) {
+std::mutex ioMutex;
+
+
+/// OutputQueue is a bounded lock-free queue of lines, many threads can push a
+/// line while a dedicated I/O thread pops them and writes them to stdout, so
+/// the threads that push never wait on a slow reader of the pipe. The slots
+/// carry a sequence number as in Dmitry Vyukov's bounded MPMC queue: a slot
+/// is free for the push of position p when its sequence is p, and holds the
+/// line of position p when its sequence is p + 1.
+
+class OutputQueue {
+
+  static constexpr size_t Size = 1024; // Must be a power of 2
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    std::string line;
+  };
+
+public:
+  OutputQueue() {
+    for (size_t i = 0; i < Size; ++i)
+        slots[i].sequence = i;
+  }
+
+  // The queue is drained before the I/O thread is terminated, so that lines
+  // such as the last "bestmove" are not lost when the program exits.
+ ~OutputQueue() {
+
+    if (!writer.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex);
+        exiting = true;
+    }
+    cv.notify_one();
+    writer.join();
+  }
+
+  // push() adds a line to the queue and returns false if the queue is full
+  bool push(std::string& line) {
+
+    std::call_once(started, [&]{ writer = std::thread(&OutputQueue::idle_loop, this); });
+
+    size_t pos = head.load(std::memory_order_relaxed);
+    Slot* slot;
+
+    while (true)
+    {
+        slot = &slots[pos & (Size - 1)];
+        intptr_t diff =  intptr_t(slot->sequence.load(std::memory_order_acquire))
+                       - intptr_t(pos);
+        if (diff < 0)
+            return false;
+
+        if (diff == 0 && head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            break;
+
+        if (diff > 0)
+            pos = head.load(std::memory_order_relaxed);
+    }
+
+    slot->line = std::move(line);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Wake up the I/O thread only if it went to sleep on an empty queue
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex);
+        cv.notify_one();
+    }
+    return true;
+  }
 
-  static std::mutex m;
+  // flush() waits until all the lines pushed so far have been written
+  void flush() {
+
+    while (written.load(std::memory_order_acquire) < head.load(std::memory_order_acquire))
+        std::this_thread::yield();
+  }
+
+private:
+  bool pop(std::string& line) {
+
+    Slot& slot = slots[tail & (Size - 1)];
+
+    if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+        return false;
+
+    line = std::move(slot.line);
+    slot.sequence.store(tail + Size, std::memory_order_release);
+    ++tail;
+    return true;
+  }
+
+  void idle_loop() {
+
+    std::string line;
+
+    while (true)
+    {
+        if (pop(line))
+        {
+            {
+                std::lock_guard<std::mutex> lk(ioMutex);
+                std::cout << line << std::endl;
+            }
+            written.store(tail, std::memory_order_release);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(sleepMutex);
+        sleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (slots[tail & (Size - 1)].sequence.load(std::memory_order_acquire) != tail + 1)
+        {
+            if (exiting)
+                break;
+
+            cv.wait(lk);
+        }
+        sleeping = false;
+    }
+  }
+
+  Slot slots[Size];
+  std::atomic<size_t> head = 0, written = 0;
+  size_t tail = 0; // Used only by the I/O thread
+  std::atomic<bool> sleeping = false;
+  bool exiting = false;
+  std::mutex sleepMutex;
+  std::condition_variable cv;
+  std::once_flag started;
+  std::thread writer;
+};
+
+OutputQueue outputQueue;
+
+} // namespace
+
+
+std::ostream& operator<<(std::ostream& os, SyncCout sc) {
 
   if (sc == IO_LOCK)
-      m.lock();
+  {
+      outputQueue.flush(); // Keep the order of the lines sent to stdout
+      ioMutex.lock();
+  }
 
   if (sc == IO_UNLOCK)
-      m.unlock();
+      ioMutex.unlock();
 
   return os;
 }
 
 
+/// async_cout() sends a line to stdout through the I/O thread and returns at
+/// once. When the queue is full, an "info" line is dropped unless it is an
+/// "info string" one, while any other line waits for some room in the queue.
+
+void async_cout(std::string line) {
+
+  bool droppable =  line.compare(0, 5, "info ") == 0
+                 && line.compare(0, 12, "info string ") != 0;
+
+  while (!outputQueue.push(line) && !droppable)
+      std::this_thread::yield();
+}
+
+void async_cout_flush() { outputQueue.flush(); }
+
+
 /// Trampoline helper to avoid moving Logger to misc.h
 void start_logger(const std::string& fname) { Logger::start(fname); }
 
 
+/// set_binary_stdout() switches stdout to binary mode for the frames of the
+/// binary output, which only matters on Windows, where the text mode would
+/// turn each "\n" byte of a frame into "\r\n".
+
+void set_binary_stdout(bool b) {
+
+#ifdef _WIN32
+  std::lock_guard<std::mutex> lk(ioMutex);
+  std::cout.flush();
+  _setmode(_fileno(stdout), b ? _O_BINARY : _O_TEXT);
+#else
+  (void)b;
+#endif
+}
+
+
+/// parse_number() reads a whole argument of a command as an integer, and returns
+/// false if it is not one, so that the commands can report bad arguments.
+
+bool parse_number(const std::string& s, int64_t& v) {
+
+  std::istringstream is(s);
+  return (is >> v) && (is >> std::ws).eof();
+}
+
+
 /// prefetch() preloads the given address in L1/L2 cache. This is a non-blocking
 /// function that doesn't stall the CPU waiting for data to be loaded from memory,
 /// which can be quite slow.
@@ -612,6 +809,103 @@ void bindThisThread(size_t idx) {
 
 } // namespace WinProcGroup
 
+
+/// PerfCounters::start() opens the counters of all the events for the threads
+/// with the given system ids, as returned by thread_id(), and starts them.
+
+void PerfCounters::start(const std::vector<int>& threadIds) {
+
+  stop();
+  threadCount = threadIds.size();
+  runs++;
+
+  for (int e = 0; e < EVENT_NB; ++e)
+      for (int tid : threadIds)
+      {
+          int fd = -1;
+
+#if defined(__linux__) && !defined(__ANDROID__)
+          constexpr uint64_t CacheReadMiss =  (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+          constexpr std::pair<uint32_t, uint64_t> Configs[EVENT_NB] = {
+              { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+              { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+              { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+              { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D  | CacheReadMiss },
+              { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL   | CacheReadMiss },
+              { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | CacheReadMiss }
+          };
+
+          perf_event_attr attr = {};
+          attr.size = sizeof(attr);
+          attr.type = Configs[e].first;
+          attr.config = Configs[e].second;
+          attr.exclude_kernel = 1;
+          attr.exclude_hv = 1;
+          attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+          fd = int(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+#else
+          (void)tid;
+#endif
+
+          if (fd < 0)
+              failures[e]++;
+
+          fds.push_back(fd);
+      }
+}
+
+
+/// PerfCounters::stop() reads the counters, adds them to the totals and closes
+/// them. When the kernel had to share the hardware counters between too many
+/// events, the counts are scaled to the time the events were enabled.
+
+void PerfCounters::stop() {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+  for (size_t i = 0; i < fds.size(); ++i)
+  {
+      uint64_t values[3]; // Count, time enabled and time running
+
+      if (fds[i] < 0)
+          continue;
+
+      if (read(fds[i], values, sizeof(values)) == sizeof(values) && values[2])
+          totals[i / threadCount] += uint64_t(double(values[0]) * values[1] / values[2]);
+
+      close(fds[i]);
+  }
+#endif
+
+  fds.clear();
+}
+
+
+/// PerfCounters::name() returns the name of an event, as printed by bench
+
+const char* PerfCounters::name(Event e) {
+
+  constexpr const char* Names[EVENT_NB] = {
+      "Cycles", "Instructions", "Branch misses", "L1d misses", "LLC misses", "dTLB misses"
+  };
+
+  return Names[e];
+}
+
+
+/// PerfCounters::thread_id() returns the system id of the calling thread, which
+/// is needed to count the events of a thread from another thread.
+
+int PerfCounters::thread_id() {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+  return int(syscall(SYS_gettid));
+#else
+  return 0;
+#endif
+}
+
 #ifdef _WIN32
 #include <direct.h>
 #define GETCWD _getcwd
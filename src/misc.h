@@ -21,6 +21,9 @@
 
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -34,6 +37,8 @@ std::string engine_info(bool to_uci = false);
 std::string compiler_info();
 void prefetch(void* addr);
 void start_logger(const std::string& fname);
+void set_binary_stdout(bool b);
+bool parse_number(const std::string& s, int64_t& v);
 void* std_aligned_alloc(size_t alignment, size_t size);
 void std_aligned_free(void* ptr);
 void* aligned_large_pages_alloc(size_t size); // memory aligned by page size, min alignment: 4096 bytes
@@ -66,6 +71,9 @@ std::ostream& operator<<(std::ostream&, SyncCout);
 #define sync_cout std::cout << IO_LOCK
 #define sync_endl std::endl << IO_UNLOCK
 
+void async_cout(std::string line);
+void async_cout_flush();
+
 
 // align_ptr_up() : get the first aligned element of an array.
 // ptr must point to an array of size at least `sizeof(T) * N + alignment` bytes,
@@ -139,6 +147,52 @@ private:
 };
 
 
+/// BoundedQueue is a FIFO queue shared by producer and consumer threads. push()
+/// blocks while the queue is full, and pop() while it is empty. Once close() has
+/// been called, push() drops the items and pop() returns false when the queue is
+/// empty, so that the consumers can terminate.
+
+template <typename T>
+class BoundedQueue {
+
+public:
+  explicit BoundedQueue(std::size_t capacity) : capacity_(capacity) {}
+
+  void push(T item) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    notFull_.wait(lk, [&]{ return items_.size() < capacity_ || closed_; });
+    if (closed_)
+        return;
+    items_.push_back(std::move(item));
+    notEmpty_.notify_one();
+  }
+
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    notEmpty_.wait(lk, [&]{ return !items_.empty() || closed_; });
+    if (items_.empty())
+        return false;
+    item = std::move(items_.front());
+    items_.pop_front();
+    notFull_.notify_one();
+    return true;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    closed_ = true;
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+  }
+
+private:
+  std::deque<T> items_;
+  std::size_t capacity_;
+  bool closed_ = false;
+  std::mutex mutex_;
+  std::condition_variable notFull_, notEmpty_;
+};
+
 /// sigmoid(t, x0, y0, C, P, Q) implements a sigmoid-like function using only integers,
 /// with the following properties:
 ///
@@ -226,6 +280,34 @@ namespace WinProcGroup {
   void bindThisThread(size_t idx);
 }
 
+/// PerfCounters counts the hardware events of a set of threads with the Linux
+/// perf_event_open() system call, for the "perf" mode of bench. The counters
+/// count the user space events of the threads between start() and stop(), and
+/// are added to the totals. An event that the kernel or the CPU does not
+/// support, on any of the threads, is reported as not available.
+
+class PerfCounters {
+
+public:
+  enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, L1D_MISSES, LLC_MISSES, DTLB_MISSES, EVENT_NB };
+
+ ~PerfCounters() { stop(); }
+  void start(const std::vector<int>& threadIds);
+  void stop();
+  bool available(Event e) const { return runs && !failures[e]; }
+  uint64_t total(Event e) const { return totals[e]; }
+
+  static const char* name(Event e);
+  static int thread_id();
+
+private:
+  std::vector<int> fds; // For each event, the counters of the threads
+  size_t threadCount = 0;
+  int runs = 0;
+  int failures[EVENT_NB] = {};
+  uint64_t totals[EVENT_NB] = {};
+};
+
 namespace CommandLine {
   void init(int argc, char* argv[]);
 
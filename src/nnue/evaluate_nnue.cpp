@@ -18,14 +18,21 @@
 
 // Code for calculating NNUE evaluation function
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <set>
 #include <sstream>
 #include <iomanip>
 #include <fstream>
+#include <thread>
+#include <vector>
 
 #include "../evaluate.h"
+#include "../movegen.h"
 #include "../position.h"
+#include "../thread.h"
 #include "../misc.h"
 #include "../uci.h"
 #include "../types.h"
@@ -34,15 +41,23 @@
 
 namespace Stockfish::Eval::NNUE {
 
-  // Input feature converter
-  LargePagePtr<FeatureTransformer> featureTransformer;
+  // Input feature converters
+  LargePagePtr<FeatureTransformerBig> featureTransformerBig;
+  LargePagePtr<FeatureTransformerSmall> featureTransformerSmall;
 
-  // Evaluation function
-  AlignedPtr<Network> network[LayerStacks];
+  // Evaluation functions
+  AlignedPtr<NetworkBig> networkBig[LayerStacks];
+  AlignedPtr<NetworkSmall> networkSmall[LayerStacks];
 
-  // Evaluation function file name
-  std::string fileName;
-  std::string netDescription;
+  // Evaluation function file names
+  std::string fileName[2];
+  std::string netDescription[2];
+
+  // Update the accumulators in Position::do_move() instead of in evaluate()
+  bool eagerUpdate;
+
+  // Prefetch in Position::do_move() the weights of the lazy update
+  bool prefetchColumns;
 
   namespace Detail {
 
@@ -64,30 +79,41 @@ namespace Stockfish::Eval::NNUE {
 
   // Read evaluation function parameters
   template <typename T>
-  bool read_parameters(std::istream& stream, T& reference) {
+  bool read_parameters(std::istream& stream, T& reference,
+                       std::uint32_t hashValue = T::get_hash_value()) {
 
     std::uint32_t header;
     header = read_little_endian<std::uint32_t>(stream);
-    if (!stream || header != T::get_hash_value()) return false;
+    if (!stream || header != hashValue) return false;
     return reference.read_parameters(stream);
   }
 
   // Write evaluation function parameters
   template <typename T>
-  bool write_parameters(std::ostream& stream, const T& reference) {
+  bool write_parameters(std::ostream& stream, const T& reference,
+                        std::uint32_t hashValue = T::get_hash_value()) {
 
-    write_little_endian<std::uint32_t>(stream, T::get_hash_value());
+    write_little_endian<std::uint32_t>(stream, hashValue);
     return reference.write_parameters(stream);
   }
 
   }  // namespace Detail
 
-  // Initialize the evaluation function parameters
-  void initialize() {
+  // Feature transformer and layer stacks of the given network
+  template<NetSize Net>
+  auto& feature_transformer() {
+    if constexpr (Net == Big)
+        return featureTransformerBig;
+    else
+        return featureTransformerSmall;
+  }
 
-    Detail::initialize(featureTransformer);
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-      Detail::initialize(network[i]);
+  template<NetSize Net>
+  auto& network() {
+    if constexpr (Net == Big)
+        return networkBig;
+    else
+        return networkSmall;
   }
 
   // Read network header
@@ -114,31 +140,189 @@ namespace Stockfish::Eval::NNUE {
     return !stream.fail();
   }
 
-  // Read network parameters
-  bool read_parameters(std::istream& stream) {
+  // Input stream over a part of a buffer that is already in memory
+  class MemoryBuffer : public std::basic_streambuf<char> {
+    public: MemoryBuffer(char* p, std::size_t n) { setg(p, p, p + n); }
+  };
+
+  // Run the given tasks on the given number of threads, and return whether all
+  // of them succeeded.
+  bool run_parallel(const std::vector<std::function<bool()>>& tasks, std::size_t threadCount) {
+
+    std::atomic<std::size_t> next(0);
+    std::atomic<bool> ok(true);
+    auto worker = [&]() {
+        for (std::size_t i; (i = next++) < tasks.size(); )
+            if (!tasks[i]())
+                ok = false;
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& th : threads)
+        th.join();
+
+    return ok;
+  }
 
+  // Read network parameters into the given feature transformer and layer stacks.
+  // The file is read into memory first. The sections of the feature transformer
+  // and of each layer stack are at known offsets, so they are then parsed in
+  // parallel. The time of each step is reported with an info string.
+  template<NetSize Net, typename TransformerPtr, typename NetworkPtr>
+  bool read_parameters(std::istream& stream, TransformerPtr& transformerPtr,
+                       NetworkPtr (&networks)[LayerStacks], std::string& description,
+                       const std::string& name) {
+
+    using Transformer = std::remove_reference_t<decltype(*transformerPtr)>;
+    using Net_t = std::remove_reference_t<decltype(*networks[0])>;
+
+    const TimePoint start = now();
+
+    std::vector<char> data;
+    char chunk[1 << 16];
+    while (stream.read(chunk, sizeof(chunk)) || stream.gcount() > 0)
+        data.insert(data.end(), chunk, chunk + stream.gcount());
+
+    const TimePoint readEnd = now();
+
+    MemoryBuffer headerBuffer(data.data(), data.size());
+    std::istream header(&headerBuffer);
     std::uint32_t hashValue;
-    if (!read_header(stream, &hashValue, &netDescription)) return false;
-    if (hashValue != HashValue) return false;
-    if (!Detail::read_parameters(stream, *featureTransformer)) return false;
+    if (!read_header(header, &hashValue, &description)) return false;
+    if (hashValue != HashValue[Net] && hashValue != CompactHashValue[Net]) return false;
+    const bool compact = hashValue == CompactHashValue[Net];
+
+    // Offsets of the sections, each one starting with its own hash value
+    const std::size_t transformerOffset = 3 * sizeof(std::uint32_t) + description.size();
+    const std::size_t transformerSize = sizeof(std::uint32_t) + Transformer::get_serialized_size(compact);
+    const std::size_t networkSize = sizeof(std::uint32_t) + Net_t::get_serialized_size();
+    if (data.size() != transformerOffset + transformerSize + LayerStacks * networkSize)
+        return false;
+
+    transformerPtr->set_compact(compact);
+    TimePoint transformerTime = 0;
+
+    std::vector<std::function<bool()>> tasks;
+    tasks.emplace_back([&]() {
+        const TimePoint t = now();
+        MemoryBuffer buffer(data.data() + transformerOffset, transformerSize);
+        std::istream in(&buffer);
+        const bool ok = Detail::read_parameters(in, *transformerPtr,
+                                                transformerPtr->get_hash_value(compact));
+        transformerTime = now() - t;
+        return ok;
+    });
+
     for (std::size_t i = 0; i < LayerStacks; ++i)
-      if (!Detail::read_parameters(stream, *(network[i]))) return false;
-    return stream && stream.peek() == std::ios::traits_type::eof();
+        tasks.emplace_back([&, i]() {
+            MemoryBuffer buffer(data.data() + transformerOffset + transformerSize + i * networkSize, networkSize);
+            std::istream in(&buffer);
+            return Detail::read_parameters(in, *(networks[i]));
+        });
+
+    const std::size_t threadCount = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1, tasks.size());
+    if (!run_parallel(tasks, threadCount))
+        return false;
+
+    const TimePoint end = now();
+
+    sync_cout << "info string NNUE network " << name << " loaded in " << end - start
+              << " ms (read " << readEnd - start << " ms, parse " << end - readEnd
+              << " ms on " << threadCount << " threads, of which feature transformer "
+              << transformerTime << " ms)" << sync_endl;
+
+    return true;
   }
 
-  // Write network parameters
-  bool write_parameters(std::ostream& stream) {
+  // A network loaded aside, while the engine keeps evaluating with the current
+  // one, until install_pending() swaps them.
+  template<NetSize Net>
+  struct PendingNetwork {
+    std::remove_reference_t<decltype(feature_transformer<Net>())> transformer;
+    std::remove_reference_t<decltype(network<Net>()[0])> networks[LayerStacks];
+    std::string fileName, description;
+  };
 
-    if (!write_header(stream, HashValue, netDescription)) return false;
-    if (!Detail::write_parameters(stream, *featureTransformer)) return false;
+  PendingNetwork<Big> pendingBig;
+  PendingNetwork<Small> pendingSmall;
+
+  template<NetSize Net>
+  auto& pending_network() {
+    if constexpr (Net == Big)
+        return pendingBig;
+    else
+        return pendingSmall;
+  }
+
+  // Swap the pending network with the current one. Only pointers are exchanged,
+  // the replaced network is freed by the next load.
+  template<NetSize Net>
+  void install_pending() {
+
+    auto& p = pending_network<Net>();
+    std::swap(feature_transformer<Net>(), p.transformer);
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+      std::swap(network<Net>()[i], p.networks[i]);
+    std::swap(fileName[Net], p.fileName);
+    std::swap(netDescription[Net], p.description);
+  }
+
+  // Load a network aside as the pending one. Unless it is to stay pending, it
+  // then replaces the current one, which is thus kept when the load fails.
+  template<NetSize Net>
+  bool load(std::string name, std::istream& stream, bool pending) {
+
+    auto& p = pending_network<Net>();
+    p.fileName = name;
+    Detail::initialize(p.transformer);
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+      Detail::initialize(p.networks[i]);
+
+    if (!read_parameters<Net>(stream, p.transformer, p.networks, p.description, name))
+        return false;
+
+    if (!pending)
+    {
+        install_pending<Net>();
+        p.transformer.reset();
+        for (std::size_t i = 0; i < LayerStacks; ++i)
+          p.networks[i].reset();
+    }
+
+    return true;
+  }
+
+  // Write network parameters. With compact set, the feature transformer
+  // weights are written as int8 and the number of clipped ones is returned in
+  // clipped, the loaded network being left unchanged.
+  template<NetSize Net>
+  bool write_parameters(std::ostream& stream, bool compact = false, std::size_t* clipped = nullptr) {
+
+    const auto& transformer = *feature_transformer<Net>();
+    compact |= transformer.is_compact();
+    if (!write_header(stream, compact ? CompactHashValue[Net] : HashValue[Net], netDescription[Net])) return false;
+    write_little_endian<std::uint32_t>(stream, transformer.get_hash_value(compact));
+    if (compact)
+    {
+        std::size_t c = transformer.write_compact_parameters(stream);
+        if (clipped)
+            *clipped = c;
+    }
+    else if (!transformer.write_parameters(stream)) return false;
     for (std::size_t i = 0; i < LayerStacks; ++i)
-      if (!Detail::write_parameters(stream, *(network[i]))) return false;
+      if (!Detail::write_parameters(stream, *(network<Net>()[i]))) return false;
     return (bool)stream;
   }
 
   // Evaluation function. Perform differential calculation.
+  template<NetSize Net>
   Value evaluate(const Position& pos, bool adjusted, int* complexity) {
 
+    using Transformer = std::remove_reference_t<decltype(*feature_transformer<Net>())>;
+
     // We manually align the arrays on the stack because with gcc < 9.3
     // overaligning stack variables with alignas() doesn't work correctly.
 
@@ -147,19 +331,19 @@ namespace Stockfish::Eval::NNUE {
 
 #if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
     TransformedFeatureType transformedFeaturesUnaligned[
-      FeatureTransformer::BufferSize + alignment / sizeof(TransformedFeatureType)];
+      Transformer::BufferSize + alignment / sizeof(TransformedFeatureType)];
 
     auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
 #else
     alignas(alignment)
-      TransformedFeatureType transformedFeatures[FeatureTransformer::BufferSize];
+      TransformedFeatureType transformedFeatures[Transformer::BufferSize];
 #endif
 
     ASSERT_ALIGNED(transformedFeatures, alignment);
 
     const int bucket = (pos.count<ALL_PIECES>() - 1) / 4;
-    const auto psqt = featureTransformer->transform(pos, transformedFeatures, bucket);
-    const auto positional = network[bucket]->propagate(transformedFeatures);
+    const auto psqt = feature_transformer<Net>()->transform(pos, transformedFeatures, bucket);
+    const auto positional = network<Net>()[bucket]->propagate(transformedFeatures);
 
     if (complexity)
         *complexity = abs(psqt - positional) / OutputScale;
@@ -171,6 +355,42 @@ namespace Stockfish::Eval::NNUE {
         return static_cast<Value>((psqt + positional) / OutputScale);
   }
 
+  template Value evaluate<Big>(const Position& pos, bool adjusted, int* complexity);
+  template Value evaluate<Small>(const Position& pos, bool adjusted, int* complexity);
+
+  // PSQT term of the evaluation alone, in the same units as evaluate(). It skips
+  // transform() and the layer stack, so it is much cheaper when the accumulators
+  // are up to date, but it misses the positional part of the evaluation.
+  template<NetSize Net>
+  Value evaluate_psqt(const Position& pos) {
+
+    const int bucket = (pos.count<ALL_PIECES>() - 1) / 4;
+    return static_cast<Value>(feature_transformer<Net>()->psqt(pos, bucket) / OutputScale);
+  }
+
+  template Value evaluate_psqt<Big>(const Position& pos);
+  template Value evaluate_psqt<Small>(const Position& pos);
+
+  // Eager accumulator update, called by Position::do_move() after the move is
+  // made, of the network that will evaluate the position.
+  void update_eager(const Position& pos) {
+
+    if (net_size(pos) == Small)
+        featureTransformerSmall->update_accumulator_eager(pos);
+    else
+        featureTransformerBig->update_accumulator_eager(pos);
+  }
+
+  // Prefetch of the weights the next accumulator update will need, in the
+  // network that will evaluate the position.
+  void prefetch_columns(const Position& pos) {
+
+    if (net_size(pos) == Small)
+        featureTransformerSmall->prefetch_changed_columns(pos);
+    else
+        featureTransformerBig->prefetch_changed_columns(pos);
+  }
+
   struct NnueEvalTrace {
     static_assert(LayerStacks == PSQTBuckets);
 
@@ -188,12 +408,12 @@ namespace Stockfish::Eval::NNUE {
 
 #if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
     TransformedFeatureType transformedFeaturesUnaligned[
-      FeatureTransformer::BufferSize + alignment / sizeof(TransformedFeatureType)];
+      FeatureTransformerBig::BufferSize + alignment / sizeof(TransformedFeatureType)];
 
     auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
 #else
     alignas(alignment)
-      TransformedFeatureType transformedFeatures[FeatureTransformer::BufferSize];
+      TransformedFeatureType transformedFeatures[FeatureTransformerBig::BufferSize];
 #endif
 
     ASSERT_ALIGNED(transformedFeatures, alignment);
@@ -201,8 +421,8 @@ namespace Stockfish::Eval::NNUE {
     NnueEvalTrace t{};
     t.correctBucket = (pos.count<ALL_PIECES>() - 1) / 4;
     for (IndexType bucket = 0; bucket < LayerStacks; ++bucket) {
-      const auto materialist = featureTransformer->transform(pos, transformedFeatures, bucket);
-      const auto positional = network[bucket]->propagate(transformedFeatures);
+      const auto materialist = featureTransformerBig->transform(pos, transformedFeatures, bucket);
+      const auto positional = networkBig[bucket]->propagate(transformedFeatures);
 
       t.psqt[bucket] = static_cast<Value>( materialist / OutputScale );
       t.positional[bucket] = static_cast<Value>( positional / OutputScale );
@@ -286,7 +506,7 @@ namespace Stockfish::Eval::NNUE {
 
     // We estimate the value of each piece by doing a differential evaluation from
     // the current base eval, simulating the removal of the piece from its square.
-    Value base = evaluate(pos);
+    Value base = evaluate<Big>(pos);
     base = pos.side_to_move() == WHITE ? base : -base;
 
     for (File f = FILE_A; f <= FILE_H; ++f)
@@ -301,16 +521,16 @@ namespace Stockfish::Eval::NNUE {
           auto st = pos.state();
 
           pos.remove_piece(sq);
-          st->accumulator.computed[WHITE] = false;
-          st->accumulator.computed[BLACK] = false;
+          st->accumulatorBig.computed[WHITE] = false;
+          st->accumulatorBig.computed[BLACK] = false;
 
-          Value eval = evaluate(pos);
+          Value eval = evaluate<Big>(pos);
           eval = pos.side_to_move() == WHITE ? eval : -eval;
           v = base - eval;
 
           pos.put_piece(pc, sq);
-          st->accumulator.computed[WHITE] = false;
-          st->accumulator.computed[BLACK] = false;
+          st->accumulatorBig.computed[WHITE] = false;
+          st->accumulatorBig.computed[BLACK] = false;
         }
 
         writeSquare(f, r, pc, v);
@@ -355,25 +575,266 @@ namespace Stockfish::Eval::NNUE {
   }
 
 
+  // Name of the SIMD code path the network layers were compiled for
+  static std::string simd_path() {
+
+#if defined(USE_VNNI)
+    return "AVX512-VNNI";
+#elif defined(USE_AVX512)
+    return "AVX512";
+#elif defined(USE_AVX2)
+    return "AVX2";
+#elif defined(USE_SSE41)
+    return "SSE4.1";
+#elif defined(USE_SSSE3)
+    return "SSSE3";
+#elif defined(USE_SSE2)
+    return "SSE2";
+#elif defined(USE_MMX)
+    return "MMX";
+#elif defined(USE_NEON)
+    return "NEON";
+#else
+    return "generic";
+#endif
+  }
+
+  // Timing of one building block of the network in benchmark()
+  struct BenchEntry {
+
+    std::string name;
+    double ns = 0, bytes = 0;
+    std::uint64_t calls = 0;
+
+    template<typename TimePoint>
+    void add(TimePoint start, TimePoint end, int count, double bytesPerCall) {
+      ns += std::chrono::duration<double, std::nano>(end - start).count();
+      bytes += bytesPerCall * count;
+      calls += count;
+    }
+  };
+
+  // Bytes read and written by one call of a layer: its parameters, input and output
+  template<typename Layer>
+  constexpr double layer_bytes() {
+    return (std::is_empty_v<Layer> ? 0 : sizeof(Layer))
+          + Layer::InputDimensions  * sizeof(typename Layer::InputType)
+          + Layer::OutputDimensions * sizeof(typename Layer::OutputType);
+  }
+
+  // benchmark<Net>() times the building blocks of the given network, each one
+  // in a loop of 'iterations' calls, on the given positions and their moves.
+  template<NetSize Net>
+  void benchmark(Thread* th, const std::vector<std::string>& fens, int iterations) {
+
+    using Clock = std::chrono::steady_clock;
+    using Transformer = std::remove_reference_t<decltype(*feature_transformer<Net>())>;
+    using Arch = std::remove_reference_t<decltype(*network<Net>()[0])>;
+
+    struct alignas(CacheLineSize) Buffer {
+      alignas(CacheLineSize) TransformedFeatureType features[Transformer::BufferSize];
+      alignas(CacheLineSize) typename decltype(Arch::fc_0)::OutputBuffer fc_0_out;
+      alignas(CacheLineSize) typename decltype(Arch::ac_sqr_0)::OutputType ac_sqr_0_out[ceil_to_multiple<IndexType>(Arch::FC_0_OUTPUTS * 2, 32)];
+      alignas(CacheLineSize) typename decltype(Arch::ac_0)::OutputBuffer ac_0_out;
+      alignas(CacheLineSize) typename decltype(Arch::fc_1)::OutputBuffer fc_1_out;
+      alignas(CacheLineSize) typename decltype(Arch::ac_1)::OutputBuffer ac_1_out;
+      alignas(CacheLineSize) typename decltype(Arch::fc_2)::OutputBuffer fc_2_out;
+    };
+
+    auto buffer = std::make_unique<Buffer>();
+    const auto& transformer = *feature_transformer<Net>();
+
+    constexpr IndexType HalfDimensions = Transformer::OutputDimensions;
+    const double columnBytes = HalfDimensions * (transformer.is_compact() ? 1 : 2) + PSQTBuckets * 4;
+    const double accumulatorBytes = HalfDimensions * 2 + PSQTBuckets * 4;
+
+    BenchEntry refresh     { "update_accumulator() refresh" },
+               incremental { "update_accumulator() incremental" },
+               transform   { "transform()" },
+               fc_0        { "fc_0 AffineTransform::propagate()" },
+               ac_sqr_0    { "ac_sqr_0 SqrClippedReLU::propagate()" },
+               ac_0        { "ac_0 ClippedReLU::propagate()" },
+               fc_1        { "fc_1 AffineTransform::propagate()" },
+               ac_1        { "ac_1 ClippedReLU::propagate()" },
+               fc_2        { "fc_2 AffineTransform::propagate()" },
+               fused       { "fc_1 + ac_1 + fc_2 propagate_fused()" },
+               full        { "Network::propagate()" },
+               evalFull    { "NNUE::evaluate()" },
+               evalPsqt    { "NNUE::evaluate_psqt()" };
+
+    auto invalidate = [](StateInfo* st) {
+      st->accumulatorBig.computed[WHITE] = st->accumulatorBig.computed[BLACK] = false;
+      st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
+    };
+
+    // Time 'iterations' calls of a layer on its input buffer. The buffers are
+    // passed through volatile pointers, so that the compiler cannot hoist the
+    // calls of the cheapest layers out of the loop.
+    auto time_layer = [&](BenchEntry& entry, const auto& layer, const auto* input, auto* output) {
+      using Layer = std::remove_reference_t<decltype(layer)>;
+      const auto* volatile in = input;
+      auto* volatile out = output;
+      auto start = Clock::now();
+      for (int i = 0; i < iterations; ++i)
+          layer.propagate(in, out);
+      entry.add(start, Clock::now(), iterations, layer_bytes<Layer>());
+    };
+
+    for (const auto& fen : fens)
+    {
+        StateInfo rootSt;
+        Position pos;
+        pos.set(fen, false, &rootSt, th);
+
+        const int bucket = (pos.count<ALL_PIECES>() - 1) / 4;
+        auto& net = *network<Net>()[bucket];
+
+        // Full refresh of both accumulators
+        auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+        {
+            invalidate(pos.state());
+            transformer.update_accumulators(pos);
+        }
+        refresh.add(start, Clock::now(), iterations,
+                    2 * (pos.count<ALL_PIECES>() * columnBytes + accumulatorBytes));
+
+        // Incremental updates from the root, for every legal non-king move
+        for (const auto& m : MoveList<LEGAL>(pos))
+        {
+            if (type_of(pos.moved_piece(m)) == KING)
+                continue;
+
+            StateInfo st;
+            pos.do_move(m, st);
+
+            double bytes = 0;
+            for (Color perspective : { WHITE, BLACK })
+            {
+                FeatureSet::IndexList removed, added;
+                FeatureSet::append_changed_indices(
+                  pos.square<KING>(perspective), st.dirtyPiece, perspective, removed, added);
+                bytes += (removed.size() + added.size()) * columnBytes + 2 * accumulatorBytes;
+            }
+
+            start = Clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                invalidate(&st);
+                transformer.update_accumulators(pos);
+            }
+            incremental.add(start, Clock::now(), iterations, bytes);
+
+            pos.undo_move(m);
+        }
+
+        // Transform of the already computed accumulators
+        start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            transformer.transform(pos, buffer->features, bucket);
+        transform.add(start, Clock::now(), iterations,
+                      2 * HalfDimensions * sizeof(BiasType) + Transformer::BufferSize);
+
+        // Layers, one by one and then the whole stack
+        time_layer(fc_0, net.fc_0, buffer->features, buffer->fc_0_out);
+        time_layer(ac_sqr_0, net.ac_sqr_0, buffer->fc_0_out, buffer->ac_sqr_0_out);
+        time_layer(ac_0, net.ac_0, buffer->fc_0_out, buffer->ac_0_out);
+        time_layer(fc_1, net.fc_1, buffer->ac_sqr_0_out, buffer->fc_1_out);
+        time_layer(ac_1, net.ac_1, buffer->fc_1_out, buffer->ac_1_out);
+        time_layer(fc_2, net.fc_2, buffer->ac_1_out, buffer->fc_2_out);
+
+        if constexpr (decltype(net.fc_1)::template can_fuse<decltype(net.fc_2)>())
+        {
+            const auto* volatile in = buffer->ac_sqr_0_out;
+            start = Clock::now();
+            for (int i = 0; i < iterations; ++i)
+                buffer->fc_2_out[0] = net.fc_1.propagate_fused(in, net.fc_2);
+            fused.add(start, Clock::now(), iterations,
+                      layer_bytes<decltype(net.fc_1)>() + layer_bytes<decltype(net.fc_2)>());
+        }
+
+        start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            net.propagate(buffer->features);
+        full.add(start, Clock::now(), iterations,
+                   layer_bytes<decltype(net.fc_0)>() + layer_bytes<decltype(net.ac_sqr_0)>()
+                 + layer_bytes<decltype(net.ac_0)>() + layer_bytes<decltype(net.fc_1)>()
+                 + layer_bytes<decltype(net.ac_1)>() + layer_bytes<decltype(net.fc_2)>());
+
+        // Full evaluation against the PSQT term alone, with computed accumulators
+        start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            evaluate<Net>(pos);
+        evalFull.add(start, Clock::now(), iterations,
+                     2 * HalfDimensions * sizeof(BiasType) + Transformer::BufferSize + full.bytes / full.calls);
+
+        start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            evaluate_psqt<Net>(pos);
+        evalPsqt.add(start, Clock::now(), iterations, 2 * sizeof(PSQTWeightType));
+    }
+
+    sync_cout << "\nNNUE benchmark: " << fileName[Net] << " (" << HalfDimensions
+              << (transformer.is_compact() ? ", int8" : "") << "), " << simd_path()
+              << ", " << fens.size() << " positions, " << iterations << " iterations\n\n"
+              << std::left << std::setw(40) << "Function" << std::right
+              << std::setw(12) << "Calls" << std::setw(12) << "ns/call" << std::setw(10) << "GB/s"
+              << sync_endl;
+
+    for (const BenchEntry* e : { &refresh, &incremental, &transform, &fc_0, &ac_sqr_0,
+                                 &ac_0, &fc_1, &ac_1, &fc_2, &fused, &full, &evalFull, &evalPsqt })
+        if (e->calls)
+            sync_cout << std::left << std::setw(40) << e->name << std::right << std::fixed
+                      << std::setw(12) << e->calls
+                      << std::setw(12) << std::setprecision(1) << e->ns / e->calls
+                      << std::setw(10) << std::setprecision(2) << e->bytes / std::max(e->ns, 1.0)
+                      << sync_endl;
+  }
+
+  // Run the benchmark on the main network and, if loaded, on the small one.
+  // The accumulators are always updated lazily while it runs, and the positions
+  // are set up on the given thread.
+  void benchmark(Thread* th, const std::vector<std::string>& fens, int iterations) {
+
+    const bool eager = eagerUpdate;
+    eagerUpdate = false;
+
+    benchmark<Big>(th, fens, iterations);
+    if (useSmallNNUE)
+        benchmark<Small>(th, fens, iterations);
+
+    eagerUpdate = eager;
+  }
+
+
   // Load eval, from a file stream or a memory stream
-  bool load_eval(std::string name, std::istream& stream) {
+  bool load_eval(std::string name, std::istream& stream, NetSize net, bool pending) {
 
-    initialize();
-    fileName = name;
-    return read_parameters(stream);
+    return net == Small ? load<Small>(name, stream, pending)
+                        : load<Big>(name, stream, pending);
+  }
+
+  // Install the network of the given size loaded by load_eval() with pending set
+  void install_pending(NetSize net) {
+
+    if (net == Small)
+        install_pending<Small>();
+    else
+        install_pending<Big>();
   }
 
   // Save eval, to a file stream or a memory stream
   bool save_eval(std::ostream& stream) {
 
-    if (fileName.empty())
+    if (fileName[Big].empty())
       return false;
 
-    return write_parameters(stream);
+    return write_parameters<Big>(stream);
   }
 
-  /// Save eval, to a file given by its name
-  bool save_eval(const std::optional<std::string>& filename) {
+  /// Save eval, to a file given by its name. If compact is set, the network is
+  /// saved with int8 feature transformer weights, the loaded one being kept.
+  bool save_eval(const std::optional<std::string>& filename, bool compact) {
 
     std::string actualFilename;
     std::string msg;
@@ -389,15 +850,34 @@ namespace Stockfish::Eval::NNUE {
              sync_cout << msg << sync_endl;
              return false;
         }
+
+        // The name of the embedded net is the hash of its int16 file
+        if (compact && featureTransformerBig && !featureTransformerBig->is_compact())
+        {
+             msg = "Failed to export a net. An int8 net can only be saved if the filename is specified";
+
+             sync_cout << msg << sync_endl;
+             return false;
+        }
         actualFilename = EvalFileDefaultName;
     }
 
+    if (fileName[Big].empty())
+    {
+        sync_cout << "Failed to export a net" << sync_endl;
+        return false;
+    }
+
+    std::size_t clipped = 0;
     std::ofstream stream(actualFilename, std::ios_base::binary);
-    bool saved = save_eval(stream);
+    bool saved = write_parameters<Big>(stream, compact, &clipped) && stream.good();
 
     msg = saved ? "Network saved successfully to " + actualFilename
                 : "Failed to export a net";
 
+    if (saved && compact)
+        msg += ", with int8 weights, " + std::to_string(clipped) + " weights clipped";
+
     sync_cout << msg << sync_endl;
     return saved;
   }
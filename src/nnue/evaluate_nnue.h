@@ -22,14 +22,29 @@
 #define NNUE_EVALUATE_NNUE_H_INCLUDED
 
 #include "nnue_feature_transformer.h"
+#include "../position.h"
 
 #include <memory>
 
 namespace Stockfish::Eval::NNUE {
 
+  // Feature transformers and layer stacks of the main and of the small network
+  using FeatureTransformerBig = FeatureTransformer<TransformedFeatureDimensionsBig, &StateInfo::accumulatorBig>;
+  using FeatureTransformerSmall = FeatureTransformer<TransformedFeatureDimensionsSmall, &StateInfo::accumulatorSmall>;
+  using NetworkBig = Network<TransformedFeatureDimensionsBig, L2Big, L3Big>;
+  using NetworkSmall = Network<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
+
   // Hash value of evaluation function structure
-  constexpr std::uint32_t HashValue =
-      FeatureTransformer::get_hash_value() ^ Network::get_hash_value();
+  constexpr std::uint32_t HashValue[2] = {
+      FeatureTransformerBig::get_hash_value() ^ NetworkBig::get_hash_value(),
+      FeatureTransformerSmall::get_hash_value() ^ NetworkSmall::get_hash_value()
+  };
+
+  // Hash value of the same structure with int8 feature transformer weights
+  constexpr std::uint32_t CompactHashValue[2] = {
+      FeatureTransformerBig::get_hash_value(true) ^ NetworkBig::get_hash_value(),
+      FeatureTransformerSmall::get_hash_value(true) ^ NetworkSmall::get_hash_value()
+  };
 
   // Deleter for automating release of memory area
   template <typename T>
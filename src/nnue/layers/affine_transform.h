@@ -233,6 +233,12 @@ namespace Stockfish::Eval::NNUE::Layers {
       return idx;
     }
 
+    // Size of the parameters in the network file
+    static constexpr std::size_t get_serialized_size() {
+      return OutputDimensions * sizeof(BiasType)
+           + OutputDimensions * PaddedInputDimensions * sizeof(WeightType);
+    }
+
     // Read network parameters
     bool read_parameters(std::istream& stream) {
       for (IndexType i = 0; i < OutputDimensions; ++i)
@@ -420,6 +426,12 @@ namespace Stockfish::Eval::NNUE::Layers {
 #endif
     }
 
+    // Size of the parameters in the network file
+    static constexpr std::size_t get_serialized_size() {
+      return OutputDimensions * sizeof(BiasType)
+           + OutputDimensions * PaddedInputDimensions * sizeof(WeightType);
+    }
+
     // Read network parameters
     bool read_parameters(std::istream& stream) {
       for (IndexType i = 0; i < OutputDimensions; ++i)
@@ -526,7 +538,92 @@ namespace Stockfish::Eval::NNUE::Layers {
       return output;
     }
 
+    // Whether propagate_fused() can chain this layer, a ClippedReLU and the
+    // single-output layer Next without leaving the registers. The clipped
+    // activations must fill whole SIMD vectors, as they do for fc_1 and fc_2.
+    template <typename Next>
+    static constexpr bool can_fuse() {
+#if defined (USE_SSSE3)
+      return   OutputDimensions % SimdWidth == 0
+            && OutputDimensions < 128
+            && Next::InputDimensions == OutputDimensions
+            && Next::OutputDimensions == 1;
+#else
+      return false;
+#endif
+    }
+
+    // Forward propagation of this layer, of a ClippedReLU and of the single-output
+    // layer next, fused. Gives the same result as the three propagate() calls.
+    template <typename Next>
+    typename Next::OutputType propagate_fused(const InputType* input, const Next& next) const {
+
+      static_assert(can_fuse<Next>());
+
+#if defined (USE_AVX2)
+      using vec_t = __m256i;
+      #define vec_setzero _mm256_setzero_si256
+      #define vec_add_dpbusd_32 Simd::m256_add_dpbusd_epi32
+      #define vec_hadd Simd::m256_hadd
+#elif defined (USE_SSSE3)
+      using vec_t = __m128i;
+      #define vec_setzero _mm_setzero_si128
+      #define vec_add_dpbusd_32 Simd::m128_add_dpbusd_epi32
+      #define vec_hadd Simd::m128_hadd
+#endif
+
+#if defined (USE_SSSE3)
+      constexpr IndexType NumClippedRegs = OutputDimensions / SimdWidth;
+
+      // This layer, through propagate(). Its few outputs stay in the L1 cache.
+      alignas(CacheLineSize) OutputBuffer sums;
+      const auto acc = reinterpret_cast<const vec_t*>(propagate(input, sums));
+
+      // ClippedReLU, four registers of int32 give one register of uint8
+      vec_t clipped[NumClippedRegs];
+      for (IndexType k = 0; k < NumClippedRegs; ++k)
+      {
+# if defined (USE_AVX2)
+        const vec_t words0 = _mm256_srai_epi16(_mm256_packs_epi32(acc[4 * k + 0], acc[4 * k + 1]), WeightScaleBits);
+        const vec_t words1 = _mm256_srai_epi16(_mm256_packs_epi32(acc[4 * k + 2], acc[4 * k + 3]), WeightScaleBits);
+        clipped[k] = _mm256_permutevar8x32_epi32(
+            _mm256_max_epi8(_mm256_packs_epi16(words0, words1), _mm256_setzero_si256()),
+            _mm256_set_epi32(7, 3, 6, 2, 5, 1, 4, 0));
+# else
+        const vec_t words0 = _mm_srai_epi16(_mm_packs_epi32(acc[4 * k + 0], acc[4 * k + 1]), WeightScaleBits);
+        const vec_t words1 = _mm_srai_epi16(_mm_packs_epi32(acc[4 * k + 2], acc[4 * k + 3]), WeightScaleBits);
+        const vec_t packedbytes = _mm_packs_epi16(words0, words1);
+#   if defined (USE_SSE41)
+        clipped[k] = _mm_max_epi8(packedbytes, _mm_setzero_si128());
+#   else
+        const vec_t k0x80s = _mm_set1_epi8(-128);
+        clipped[k] = _mm_subs_epi8(_mm_adds_epi8(packedbytes, k0x80s), k0x80s);
+#   endif
+# endif
+      }
+
+      // The single output of the next layer
+      vec_t sum = vec_setzero();
+      const auto row = reinterpret_cast<const vec_t*>(next.weights);
+      for (IndexType k = 0; k < NumClippedRegs; ++k)
+        vec_add_dpbusd_32(sum, clipped[k], row[k]);
+
+      return vec_hadd(sum, next.biases[0]);
+
+# undef vec_setzero
+# undef vec_add_dpbusd_32
+# undef vec_hadd
+#else
+      (void)input;
+      (void)next;
+      return 0;
+#endif
+    }
+
    private:
+    template <IndexType, IndexType, typename>
+    friend class AffineTransform;
+
     using BiasType = OutputType;
     using WeightType = std::int8_t;
 
@@ -48,6 +48,11 @@ namespace Stockfish::Eval::NNUE::Layers {
       return hashValue;
     }
 
+    // Size of the parameters in the network file, there are none
+    static constexpr std::size_t get_serialized_size() {
+      return 0;
+    }
+
     // Read network parameters
     bool read_parameters(std::istream&) {
       return true;
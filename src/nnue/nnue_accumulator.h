@@ -26,8 +26,9 @@
 namespace Stockfish::Eval::NNUE {
 
   // Class that holds the result of affine transformation of input features
+  template<IndexType Size>
   struct alignas(CacheLineSize) Accumulator {
-    std::int16_t accumulation[2][TransformedFeatureDimensions];
+    std::int16_t accumulation[2][Size];
     std::int32_t psqtAccumulation[2][PSQTBuckets];
     bool computed[2];
   };
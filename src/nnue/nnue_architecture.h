@@ -38,15 +38,25 @@ namespace Stockfish::Eval::NNUE {
 // Input features used in evaluation function
 using FeatureSet = Features::HalfKAv2_hm;
 
-// Number of input feature dimensions after conversion
-constexpr IndexType TransformedFeatureDimensions = 1024;
+// Number of input feature dimensions after conversion, for the main network
+// and for the optional small network used in lopsided positions
+constexpr IndexType TransformedFeatureDimensionsBig = 1024;
+constexpr int L2Big = 15;
+constexpr int L3Big = 32;
+
+constexpr IndexType TransformedFeatureDimensionsSmall = 128;
+constexpr int L2Small = 15;
+constexpr int L3Small = 32;
+
 constexpr IndexType PSQTBuckets = 8;
 constexpr IndexType LayerStacks = 8;
 
+template<IndexType L1, int L2, int L3>
 struct Network
 {
-  static constexpr int FC_0_OUTPUTS = 15;
-  static constexpr int FC_1_OUTPUTS = 32;
+  static constexpr IndexType TransformedFeatureDimensions = L1;
+  static constexpr int FC_0_OUTPUTS = L2;
+  static constexpr int FC_1_OUTPUTS = L3;
 
   Layers::AffineTransform<TransformedFeatureDimensions, FC_0_OUTPUTS + 1> fc_0;
   Layers::SqrClippedReLU<FC_0_OUTPUTS + 1> ac_sqr_0;
@@ -70,6 +80,15 @@ struct Network
     return hashValue;
   }
 
+  // Size of the parameters in the network file, hash value excluded
+  static constexpr std::size_t get_serialized_size() {
+    return decltype(fc_0)::get_serialized_size()
+         + decltype(ac_0)::get_serialized_size()
+         + decltype(fc_1)::get_serialized_size()
+         + decltype(ac_1)::get_serialized_size()
+         + decltype(fc_2)::get_serialized_size();
+  }
+
   // Read network parameters
   bool read_parameters(std::istream& stream) {
     if (!fc_0.read_parameters(stream)) return false;
@@ -94,12 +113,12 @@ struct Network
   {
     struct alignas(CacheLineSize) Buffer
     {
-      alignas(CacheLineSize) decltype(fc_0)::OutputBuffer fc_0_out;
-      alignas(CacheLineSize) decltype(ac_sqr_0)::OutputType ac_sqr_0_out[ceil_to_multiple<IndexType>(FC_0_OUTPUTS * 2, 32)];
-      alignas(CacheLineSize) decltype(ac_0)::OutputBuffer ac_0_out;
-      alignas(CacheLineSize) decltype(fc_1)::OutputBuffer fc_1_out;
-      alignas(CacheLineSize) decltype(ac_1)::OutputBuffer ac_1_out;
-      alignas(CacheLineSize) decltype(fc_2)::OutputBuffer fc_2_out;
+      alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out;
+      alignas(CacheLineSize) typename decltype(ac_sqr_0)::OutputType ac_sqr_0_out[ceil_to_multiple<IndexType>(FC_0_OUTPUTS * 2, 32)];
+      alignas(CacheLineSize) typename decltype(ac_0)::OutputBuffer ac_0_out;
+      alignas(CacheLineSize) typename decltype(fc_1)::OutputBuffer fc_1_out;
+      alignas(CacheLineSize) typename decltype(ac_1)::OutputBuffer ac_1_out;
+      alignas(CacheLineSize) typename decltype(fc_2)::OutputBuffer fc_2_out;
 
       Buffer()
       {
@@ -119,10 +138,17 @@ struct Network
     fc_0.propagate(transformedFeatures, buffer.fc_0_out);
     ac_sqr_0.propagate(buffer.fc_0_out, buffer.ac_sqr_0_out);
     ac_0.propagate(buffer.fc_0_out, buffer.ac_0_out);
-    std::memcpy(buffer.ac_sqr_0_out + FC_0_OUTPUTS, buffer.ac_0_out, FC_0_OUTPUTS * sizeof(decltype(ac_0)::OutputType));
-    fc_1.propagate(buffer.ac_sqr_0_out, buffer.fc_1_out);
-    ac_1.propagate(buffer.fc_1_out, buffer.ac_1_out);
-    fc_2.propagate(buffer.ac_1_out, buffer.fc_2_out);
+    std::memcpy(buffer.ac_sqr_0_out + FC_0_OUTPUTS, buffer.ac_0_out, FC_0_OUTPUTS * sizeof(typename decltype(ac_0)::OutputType));
+
+    // The small output layers are fused when the SIMD path allows it
+    if constexpr (decltype(fc_1)::template can_fuse<decltype(fc_2)>())
+        buffer.fc_2_out[0] = fc_1.propagate_fused(buffer.ac_sqr_0_out, fc_2);
+    else
+    {
+        fc_1.propagate(buffer.ac_sqr_0_out, buffer.fc_1_out);
+        ac_1.propagate(buffer.fc_1_out, buffer.ac_1_out);
+        fc_2.propagate(buffer.ac_1_out, buffer.fc_2_out);
+    }
 
     // buffer.fc_0_out[FC_0_OUTPUTS] is such that 1.0 is equal to 127*(1<<WeightScaleBits) in quantized form
     // but we want 1.0 to be equal to 600*OutputScale
@@ -23,13 +23,16 @@
 
 #include "nnue_common.h"
 #include "nnue_architecture.h"
+#include "nnue_accumulator.h"
 
+#include <algorithm> // std::clamp()
 #include <cstring> // std::memset()
 
 namespace Stockfish::Eval::NNUE {
 
   using BiasType       = std::int16_t;
   using WeightType     = std::int16_t;
+  using CompactWeightType = std::int8_t;
   using PSQTWeightType = std::int32_t;
 
   // If vector instructions are enabled, we update and refresh the
@@ -61,6 +64,7 @@ namespace Stockfish::Eval::NNUE {
   #define vec_add_psqt_32(a,b) _mm256_add_epi32(a,b)
   #define vec_sub_psqt_32(a,b) _mm256_sub_epi32(a,b)
   #define vec_zero_psqt() _mm256_setzero_si256()
+  #define vec_load_widen_8(a) _mm512_cvtepi8_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(a)))
   #define NumRegistersSIMD 32
   #define MaxChunkSize 64
 
@@ -85,6 +89,7 @@ namespace Stockfish::Eval::NNUE {
   #define vec_add_psqt_32(a,b) _mm256_add_epi32(a,b)
   #define vec_sub_psqt_32(a,b) _mm256_sub_epi32(a,b)
   #define vec_zero_psqt() _mm256_setzero_si256()
+  #define vec_load_widen_8(a) _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(a)))
   #define NumRegistersSIMD 16
   #define MaxChunkSize 32
 
@@ -106,6 +111,14 @@ namespace Stockfish::Eval::NNUE {
   #define vec_add_psqt_32(a,b) _mm_add_epi32(a,b)
   #define vec_sub_psqt_32(a,b) _mm_sub_epi32(a,b)
   #define vec_zero_psqt() _mm_setzero_si128()
+  inline vec_t vec_load_widen_8(const CompactWeightType* a){
+    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a));
+  #if defined(USE_SSE41)
+    return _mm_cvtepi8_epi16(bytes);
+  #else
+    return _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+  #endif
+  }
   #define NumRegistersSIMD (Is64Bit ? 16 : 8)
   #define MaxChunkSize 16
 
@@ -133,6 +146,10 @@ namespace Stockfish::Eval::NNUE {
   #define vec_add_psqt_32(a,b) _mm_add_pi32(a,b)
   #define vec_sub_psqt_32(a,b) _mm_sub_pi32(a,b)
   #define vec_zero_psqt() _mm_setzero_si64()
+  inline vec_t vec_load_widen_8(const CompactWeightType* a){
+    const __m64 bytes = _mm_cvtsi32_si64(*reinterpret_cast<const int*>(a));
+    return _mm_srai_pi16(_mm_unpacklo_pi8(bytes, bytes), 8);
+  }
   #define vec_cleanup() _mm_empty()
   #define NumRegistersSIMD 8
   #define MaxChunkSize 8
@@ -160,6 +177,7 @@ namespace Stockfish::Eval::NNUE {
   #define vec_add_psqt_32(a,b) vaddq_s32(a,b)
   #define vec_sub_psqt_32(a,b) vsubq_s32(a,b)
   #define vec_zero_psqt() psqt_vec_t{0}
+  #define vec_load_widen_8(a) vmovl_s8(vld1_s8(a))
   #define NumRegistersSIMD 16
   #define MaxChunkSize 16
 
@@ -208,9 +226,6 @@ namespace Stockfish::Eval::NNUE {
 
           return 1;
       }
-
-      static constexpr int NumRegs     = BestRegisterCount<vec_t, WeightType, TransformedFeatureDimensions, NumRegistersSIMD>();
-      static constexpr int NumPsqtRegs = BestRegisterCount<psqt_vec_t, PSQTWeightType, PSQTBuckets, NumRegistersSIMD>();
       #if defined(__GNUC__)
       #pragma GCC diagnostic pop
       #endif
@@ -218,7 +233,9 @@ namespace Stockfish::Eval::NNUE {
 
 
 
-  // Input feature converter
+  // Input feature converter. Each network has its own accumulator in StateInfo.
+  template<IndexType TransformedFeatureDimensions,
+           Accumulator<TransformedFeatureDimensions> StateInfo::*accPtr>
   class FeatureTransformer {
 
    private:
@@ -226,10 +243,21 @@ namespace Stockfish::Eval::NNUE {
     static constexpr IndexType HalfDimensions = TransformedFeatureDimensions;
 
     #ifdef VECTOR
+    #if defined(__GNUC__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wignored-attributes"
+    #endif
+    static constexpr int NumRegs     = BestRegisterCount<vec_t, WeightType, TransformedFeatureDimensions, NumRegistersSIMD>();
+    static constexpr int NumPsqtRegs = BestRegisterCount<psqt_vec_t, PSQTWeightType, PSQTBuckets, NumRegistersSIMD>();
+    #if defined(__GNUC__)
+    #pragma GCC diagnostic pop
+    #endif
+
     static constexpr IndexType TileHeight = NumRegs * sizeof(vec_t) / 2;
     static constexpr IndexType PsqtTileHeight = NumPsqtRegs * sizeof(psqt_vec_t) / 4;
     static_assert(HalfDimensions % TileHeight == 0, "TileHeight must divide HalfDimensions");
     static_assert(PSQTBuckets % PsqtTileHeight == 0, "PsqtTileHeight must divide PSQTBuckets");
+    static constexpr IndexType RegisterLanes = sizeof(vec_t) / sizeof(WeightType);
     #endif
 
    public:
@@ -244,16 +272,31 @@ namespace Stockfish::Eval::NNUE {
     static constexpr std::size_t BufferSize =
         OutputDimensions * sizeof(OutputType);
 
-    // Hash value embedded in the evaluation file
-    static constexpr std::uint32_t get_hash_value() {
-      return FeatureSet::HashValue ^ (OutputDimensions * 2);
+    // Hash value embedded in the evaluation file. Nets with compact int8
+    // weights have their own hash so that both formats can be told apart.
+    static constexpr std::uint32_t get_hash_value(bool compact = false) {
+      return FeatureSet::HashValue ^ (OutputDimensions * 2) ^ (compact ? 0x9E2B6A01u : 0u);
     }
 
+    // Size of the parameters in the network file, hash value excluded
+    static constexpr std::size_t get_serialized_size(bool compact = false) {
+      return HalfDimensions * sizeof(BiasType)
+           + HalfDimensions * InputDimensions * (compact ? sizeof(CompactWeightType) : sizeof(WeightType))
+           + PSQTBuckets * InputDimensions * sizeof(PSQTWeightType);
+    }
+
+    // Select the weight format expected by read_parameters()
+    void set_compact(bool compact) { compactFormat = compact; }
+    bool is_compact() const { return compactFormat; }
+
     // Read network parameters
     bool read_parameters(std::istream& stream) {
 
       read_little_endian<BiasType      >(stream, biases     , HalfDimensions                  );
-      read_little_endian<WeightType    >(stream, weights    , HalfDimensions * InputDimensions);
+      if (compactFormat)
+          read_little_endian<CompactWeightType>(stream, compactWeights, HalfDimensions * InputDimensions);
+      else
+          read_little_endian<WeightType>(stream, weights, HalfDimensions * InputDimensions);
       read_little_endian<PSQTWeightType>(stream, psqtWeights, PSQTBuckets    * InputDimensions);
 
       return !stream.fail();
@@ -263,20 +306,53 @@ namespace Stockfish::Eval::NNUE {
     bool write_parameters(std::ostream& stream) const {
 
       write_little_endian<BiasType      >(stream, biases     , HalfDimensions                  );
-      write_little_endian<WeightType    >(stream, weights    , HalfDimensions * InputDimensions);
+      if (compactFormat)
+          write_little_endian<CompactWeightType>(stream, compactWeights, HalfDimensions * InputDimensions);
+      else
+          write_little_endian<WeightType>(stream, weights, HalfDimensions * InputDimensions);
       write_little_endian<PSQTWeightType>(stream, psqtWeights, PSQTBuckets    * InputDimensions);
 
       return !stream.fail();
     }
 
+    // Write network parameters with int8 weights, clipping the int16 weights
+    // that do not fit, column by column so that the loaded network is left
+    // as it is. Returns the number of clipped weights.
+    std::size_t write_compact_parameters(std::ostream& stream) const {
+
+      if (compactFormat)
+      {
+          write_parameters(stream);
+          return 0;
+      }
+
+      std::size_t clipped = 0;
+      CompactWeightType column[HalfDimensions];
+
+      write_little_endian<BiasType      >(stream, biases     , HalfDimensions                  );
+      for (IndexType i = 0; i < InputDimensions; ++i)
+      {
+          for (IndexType j = 0; j < HalfDimensions; ++j)
+          {
+              const int w = weights[i * HalfDimensions + j];
+              const int c = std::clamp(w, -128, 127);
+              clipped += (c != w);
+              column[j] = static_cast<CompactWeightType>(c);
+          }
+          write_little_endian<CompactWeightType>(stream, column, HalfDimensions);
+      }
+      write_little_endian<PSQTWeightType>(stream, psqtWeights, PSQTBuckets    * InputDimensions);
+
+      return clipped;
+    }
+
     // Convert input features
     std::int32_t transform(const Position& pos, OutputType* output, int bucket) const {
-      update_accumulator(pos, WHITE);
-      update_accumulator(pos, BLACK);
+      update_accumulators(pos);
 
       const Color perspectives[2] = {pos.side_to_move(), ~pos.side_to_move()};
-      const auto& accumulation = pos.state()->accumulator.accumulation;
-      const auto& psqtAccumulation = pos.state()->accumulator.psqtAccumulation;
+      const auto& accumulation = (pos.state()->*accPtr).accumulation;
+      const auto& psqtAccumulation = (pos.state()->*accPtr).psqtAccumulation;
 
       const auto psqt = (
             psqtAccumulation[perspectives[0]][bucket]
@@ -335,9 +411,367 @@ namespace Stockfish::Eval::NNUE {
 
    } // end of function transform()
 
+    // Return the PSQT term of the given bucket, without transforming the
+    // accumulators or running the layer stack. It is read from the accumulator
+    // of a perspective when this one is computed, otherwise it is summed from
+    // the PSQT weights of the bucket alone, and the accumulators are left as
+    // they are for the full evaluation.
+    std::int32_t psqt(const Position& pos, int bucket) const {
+
+      const auto& accumulator = pos.state()->*accPtr;
+      std::int32_t sum[2];
+
+      for (Color perspective : { WHITE, BLACK })
+      {
+          if (accumulator.computed[perspective])
+          {
+              sum[perspective] = accumulator.psqtAccumulation[perspective][bucket];
+              continue;
+          }
+
+          FeatureSet::IndexList active;
+          FeatureSet::append_active_indices(pos, perspective, active);
+
+          sum[perspective] = 0;
+          for (const auto index : active)
+              sum[perspective] += psqtWeights[PSQTBuckets * index + bucket];
+      }
+
+      const Color stm = pos.side_to_move();
+      return (sum[stm] - sum[~stm]) / 2;
+    }
+
+    // Update the accumulators of both perspectives. Both are updated in one
+    // pass when possible, otherwise each perspective is updated on its own.
+    // Also used by the NNUE benchmark to time the updates without transform().
+    void update_accumulators(const Position& pos) const {
+      if (update_accumulators_incremental(pos))
+          return;
+
+      update_accumulator(pos, WHITE);
+      update_accumulator(pos, BLACK);
+    }
+
+
+    // Prefetch the weight columns of the features changed by the last move, so
+    // that they are on their way to the cache when the lazy accumulator update
+    // of the position needs them. Only the first cache line of each column is
+    // requested, the hardware prefetcher follows the sequential reads from there.
+    void prefetch_changed_columns(const Position& pos) const {
+
+      const StateInfo* st = pos.state();
+
+      for (Color perspective : { WHITE, BLACK })
+      {
+        if (FeatureSet::requires_refresh(st, perspective))
+          continue;
+
+        FeatureSet::IndexList removed, added;
+        FeatureSet::append_changed_indices(
+          pos.square<KING>(perspective), st->dirtyPiece, perspective, removed, added);
+
+        for (const auto& list : { removed, added })
+          for (const auto index : list)
+          {
+            if (compactFormat)
+                prefetch(const_cast<CompactWeightType*>(&compactWeights[HalfDimensions * index]));
+            else
+                prefetch(const_cast<WeightType*>(&weights[HalfDimensions * index]));
+            prefetch(const_cast<PSQTWeightType*>(&psqtWeights[PSQTBuckets * index]));
+          }
+      }
+    }
+
+    // Update the accumulators of the current position from the ones of the
+    // previous position, if those are available, in a single pass over each
+    // tile. This is used by Position::do_move() in the eager update mode, where
+    // there is neither a backward walk nor a chain of states to update.
+    void update_accumulator_eager(const Position& pos) const {
+
+      StateInfo* st = pos.state();
+      const StateInfo* prev = st->previous;
+
+      for (Color perspective : { WHITE, BLACK })
+      {
+        if (   !(prev->*accPtr).computed[perspective]
+            ||  FeatureSet::requires_refresh(st, perspective))
+          continue;
+
+        FeatureSet::IndexList removed, added;
+        FeatureSet::append_changed_indices(
+          pos.square<KING>(perspective), st->dirtyPiece, perspective, removed, added);
+
+        (st->*accPtr).computed[perspective] = true;
+
+  #ifdef VECTOR
+        for (IndexType j = 0; j < HalfDimensions / TileHeight; ++j)
+        {
+          auto prevTile = reinterpret_cast<const vec_t*>(
+            &(prev->*accPtr).accumulation[perspective][j * TileHeight]);
+          auto accTile = reinterpret_cast<vec_t*>(
+            &(st->*accPtr).accumulation[perspective][j * TileHeight]);
+
+          vec_t acc[NumRegs];
+          for (IndexType k = 0; k < NumRegs; ++k)
+            acc[k] = vec_load(&prevTile[k]);
+
+          for (const auto index : removed)
+            apply_column<false>(acc, HalfDimensions * index + j * TileHeight);
+
+          for (const auto index : added)
+            apply_column<true>(acc, HalfDimensions * index + j * TileHeight);
+
+          for (IndexType k = 0; k < NumRegs; ++k)
+            vec_store(&accTile[k], acc[k]);
+        }
+
+        for (IndexType j = 0; j < PSQTBuckets / PsqtTileHeight; ++j)
+        {
+          auto prevTilePsqt = reinterpret_cast<const psqt_vec_t*>(
+            &(prev->*accPtr).psqtAccumulation[perspective][j * PsqtTileHeight]);
+          auto accTilePsqt = reinterpret_cast<psqt_vec_t*>(
+            &(st->*accPtr).psqtAccumulation[perspective][j * PsqtTileHeight]);
+
+          psqt_vec_t psqt[NumPsqtRegs];
+          for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+            psqt[k] = vec_load_psqt(&prevTilePsqt[k]);
+
+          for (const auto index : removed)
+          {
+            auto columnPsqt = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[PSQTBuckets * index + j * PsqtTileHeight]);
+            for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+              psqt[k] = vec_sub_psqt_32(psqt[k], columnPsqt[k]);
+          }
+
+          for (const auto index : added)
+          {
+            auto columnPsqt = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[PSQTBuckets * index + j * PsqtTileHeight]);
+            for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+              psqt[k] = vec_add_psqt_32(psqt[k], columnPsqt[k]);
+          }
+
+          for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+            vec_store_psqt(&accTilePsqt[k], psqt[k]);
+        }
+
+  #else
+        std::memcpy((st->*accPtr).accumulation[perspective],
+            (prev->*accPtr).accumulation[perspective],
+            HalfDimensions * sizeof(BiasType));
+
+        for (std::size_t k = 0; k < PSQTBuckets; ++k)
+          (st->*accPtr).psqtAccumulation[perspective][k] = (prev->*accPtr).psqtAccumulation[perspective][k];
+
+        for (const auto index : removed)
+        {
+          apply_column<false>((st->*accPtr).accumulation[perspective], HalfDimensions * index);
+
+          for (std::size_t k = 0; k < PSQTBuckets; ++k)
+            (st->*accPtr).psqtAccumulation[perspective][k] -= psqtWeights[index * PSQTBuckets + k];
+        }
+
+        for (const auto index : added)
+        {
+          apply_column<true>((st->*accPtr).accumulation[perspective], HalfDimensions * index);
+
+          for (std::size_t k = 0; k < PSQTBuckets; ++k)
+            (st->*accPtr).psqtAccumulation[perspective][k] += psqtWeights[index * PSQTBuckets + k];
+        }
+  #endif
+      }
+
+  #if defined(USE_MMX)
+      _mm_empty();
+  #endif
+    }
 
 
    private:
+  #ifdef VECTOR
+    // Add or subtract one tile of the weight column at the given offset to the
+    // accumulator registers. Compact int8 weights are sign-extended to int16.
+    template<bool Add>
+    void apply_column(vec_t* acc, IndexType offset) const {
+
+      if (compactFormat)
+      {
+          const CompactWeightType* column = &compactWeights[offset];
+          for (IndexType k = 0; k < NumRegs; ++k)
+          {
+              const vec_t w = vec_load_widen_8(column + k * RegisterLanes);
+              acc[k] = Add ? vec_add_16(acc[k], w) : vec_sub_16(acc[k], w);
+          }
+      }
+      else
+      {
+          auto column = reinterpret_cast<const vec_t*>(&weights[offset]);
+          for (IndexType k = 0; k < NumRegs; ++k)
+              acc[k] = Add ? vec_add_16(acc[k], column[k]) : vec_sub_16(acc[k], column[k]);
+      }
+    }
+  #else
+    // Add or subtract the weight column at the given offset to the accumulator
+    template<bool Add>
+    void apply_column(BiasType* acc, IndexType offset) const {
+
+      for (IndexType j = 0; j < HalfDimensions; ++j)
+      {
+          const BiasType w = compactFormat ? compactWeights[offset + j] : weights[offset + j];
+          acc[j] = Add ? acc[j] + w : acc[j] - w;
+      }
+    }
+  #endif
+
+    // Update the accumulators of both perspectives incrementally, sharing the
+    // backward walk and the gathering of the changed features. Returns false,
+    // without touching the accumulators, if an earlier position with both
+    // accumulators computed is not within reach, for example after a king
+    // move that requires a refresh of one side.
+    bool update_accumulators_incremental(const Position& pos) const {
+
+      StateInfo *st = pos.state(), *next = nullptr;
+      int gain = FeatureSet::refresh_cost(pos);
+      while (   st->previous
+             && !(st->*accPtr).computed[WHITE]
+             && !(st->*accPtr).computed[BLACK])
+      {
+        if (   FeatureSet::requires_refresh(st, WHITE)
+            || FeatureSet::requires_refresh(st, BLACK)
+            || (gain -= FeatureSet::update_cost(st) + 1) < 0)
+          break;
+        next = st;
+        st = st->previous;
+      }
+
+      if (   !(st->*accPtr).computed[WHITE]
+          || !(st->*accPtr).computed[BLACK])
+        return false;
+
+      if (next == nullptr)
+        return true;
+
+      // Gather all features to be updated, as in update_accumulator()
+      FeatureSet::IndexList removed[COLOR_NB][2], added[COLOR_NB][2];
+      for (Color perspective : { WHITE, BLACK })
+      {
+        const Square ksq = pos.square<KING>(perspective);
+        FeatureSet::append_changed_indices(
+          ksq, next->dirtyPiece, perspective, removed[perspective][0], added[perspective][0]);
+        for (StateInfo *st2 = pos.state(); st2 != next; st2 = st2->previous)
+          FeatureSet::append_changed_indices(
+            ksq, st2->dirtyPiece, perspective, removed[perspective][1], added[perspective][1]);
+
+        (next->*accPtr).computed[perspective] = true;
+        (pos.state()->*accPtr).computed[perspective] = true;
+      }
+
+      StateInfo *states_to_update[3] =
+        { next, next == pos.state() ? nullptr : pos.state(), nullptr };
+
+  #ifdef VECTOR
+      // The tiles of one perspective are done before those of the other. Holding
+      // half a tile of each perspective in the registers was measured slower.
+      vec_t acc[NumRegs];
+      psqt_vec_t psqt[NumPsqtRegs];
+
+      for (Color perspective : { WHITE, BLACK })
+        for (IndexType j = 0; j < HalfDimensions / TileHeight; ++j)
+        {
+          auto accTile = reinterpret_cast<vec_t*>(
+            &(st->*accPtr).accumulation[perspective][j * TileHeight]);
+          for (IndexType k = 0; k < NumRegs; ++k)
+            acc[k] = vec_load(&accTile[k]);
+
+          for (IndexType i = 0; states_to_update[i]; ++i)
+          {
+            for (const auto index : removed[perspective][i])
+              apply_column<false>(acc, HalfDimensions * index + j * TileHeight);
+
+            for (const auto index : added[perspective][i])
+              apply_column<true>(acc, HalfDimensions * index + j * TileHeight);
+
+            accTile = reinterpret_cast<vec_t*>(
+              &(states_to_update[i]->*accPtr).accumulation[perspective][j * TileHeight]);
+            for (IndexType k = 0; k < NumRegs; ++k)
+              vec_store(&accTile[k], acc[k]);
+          }
+        }
+
+      for (Color perspective : { WHITE, BLACK })
+        for (IndexType j = 0; j < PSQTBuckets / PsqtTileHeight; ++j)
+        {
+          auto accTilePsqt = reinterpret_cast<psqt_vec_t*>(
+            &(st->*accPtr).psqtAccumulation[perspective][j * PsqtTileHeight]);
+          for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+            psqt[k] = vec_load_psqt(&accTilePsqt[k]);
+
+          for (IndexType i = 0; states_to_update[i]; ++i)
+          {
+            for (const auto index : removed[perspective][i])
+            {
+              auto columnPsqt = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[PSQTBuckets * index + j * PsqtTileHeight]);
+              for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+                psqt[k] = vec_sub_psqt_32(psqt[k], columnPsqt[k]);
+            }
+
+            for (const auto index : added[perspective][i])
+            {
+              auto columnPsqt = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[PSQTBuckets * index + j * PsqtTileHeight]);
+              for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+                psqt[k] = vec_add_psqt_32(psqt[k], columnPsqt[k]);
+            }
+
+            accTilePsqt = reinterpret_cast<psqt_vec_t*>(
+              &(states_to_update[i]->*accPtr).psqtAccumulation[perspective][j * PsqtTileHeight]);
+            for (std::size_t k = 0; k < NumPsqtRegs; ++k)
+              vec_store_psqt(&accTilePsqt[k], psqt[k]);
+          }
+        }
+
+  #else
+      for (Color perspective : { WHITE, BLACK })
+      {
+        const StateInfo* from = st;
+
+        for (IndexType i = 0; states_to_update[i]; ++i)
+        {
+          StateInfo* to = states_to_update[i];
+
+          std::memcpy((to->*accPtr).accumulation[perspective],
+              (from->*accPtr).accumulation[perspective],
+              HalfDimensions * sizeof(BiasType));
+
+          for (std::size_t k = 0; k < PSQTBuckets; ++k)
+            (to->*accPtr).psqtAccumulation[perspective][k] = (from->*accPtr).psqtAccumulation[perspective][k];
+
+          for (const auto index : removed[perspective][i])
+          {
+            apply_column<false>((to->*accPtr).accumulation[perspective], HalfDimensions * index);
+
+            for (std::size_t k = 0; k < PSQTBuckets; ++k)
+              (to->*accPtr).psqtAccumulation[perspective][k] -= psqtWeights[index * PSQTBuckets + k];
+          }
+
+          for (const auto index : added[perspective][i])
+          {
+            apply_column<true>((to->*accPtr).accumulation[perspective], HalfDimensions * index);
+
+            for (std::size_t k = 0; k < PSQTBuckets; ++k)
+              (to->*accPtr).psqtAccumulation[perspective][k] += psqtWeights[index * PSQTBuckets + k];
+          }
+
+          from = to;
+        }
+      }
+  #endif
+
+  #if defined(USE_MMX)
+      _mm_empty();
+  #endif
+
+      return true;
+    }
+
     void update_accumulator(const Position& pos, const Color perspective) const {
 
       // The size must be enough to contain the largest possible update.
@@ -356,7 +790,7 @@ namespace Stockfish::Eval::NNUE {
       // of the estimated gain in terms of features to be added/subtracted.
       StateInfo *st = pos.state(), *next = nullptr;
       int gain = FeatureSet::refresh_cost(pos);
-      while (st->previous && !st->accumulator.computed[perspective])
+      while (st->previous && !(st->*accPtr).computed[perspective])
       {
         // This governs when a full feature refresh is needed and how many
         // updates are better than just one full refresh.
@@ -367,7 +801,7 @@ namespace Stockfish::Eval::NNUE {
         st = st->previous;
       }
 
-      if (st->accumulator.computed[perspective])
+      if ((st->*accPtr).computed[perspective])
       {
         if (next == nullptr)
           return;
@@ -385,8 +819,8 @@ namespace Stockfish::Eval::NNUE {
             ksq, st2->dirtyPiece, perspective, removed[1], added[1]);
 
         // Mark the accumulators as computed.
-        next->accumulator.computed[perspective] = true;
-        pos.state()->accumulator.computed[perspective] = true;
+        (next->*accPtr).computed[perspective] = true;
+        (pos.state()->*accPtr).computed[perspective] = true;
 
         // Now update the accumulators listed in states_to_update[], where the last element is a sentinel.
         StateInfo *states_to_update[3] =
@@ -396,7 +830,7 @@ namespace Stockfish::Eval::NNUE {
         {
           // Load accumulator
           auto accTile = reinterpret_cast<vec_t*>(
-            &st->accumulator.accumulation[perspective][j * TileHeight]);
+            &(st->*accPtr).accumulation[perspective][j * TileHeight]);
           for (IndexType k = 0; k < NumRegs; ++k)
             acc[k] = vec_load(&accTile[k]);
 
@@ -404,25 +838,15 @@ namespace Stockfish::Eval::NNUE {
           {
             // Difference calculation for the deactivated features
             for (const auto index : removed[i])
-            {
-              const IndexType offset = HalfDimensions * index + j * TileHeight;
-              auto column = reinterpret_cast<const vec_t*>(&weights[offset]);
-              for (IndexType k = 0; k < NumRegs; ++k)
-                acc[k] = vec_sub_16(acc[k], column[k]);
-            }
+              apply_column<false>(acc, HalfDimensions * index + j * TileHeight);
 
             // Difference calculation for the activated features
             for (const auto index : added[i])
-            {
-              const IndexType offset = HalfDimensions * index + j * TileHeight;
-              auto column = reinterpret_cast<const vec_t*>(&weights[offset]);
-              for (IndexType k = 0; k < NumRegs; ++k)
-                acc[k] = vec_add_16(acc[k], column[k]);
-            }
+              apply_column<true>(acc, HalfDimensions * index + j * TileHeight);
 
             // Store accumulator
             accTile = reinterpret_cast<vec_t*>(
-              &states_to_update[i]->accumulator.accumulation[perspective][j * TileHeight]);
+              &(states_to_update[i]->*accPtr).accumulation[perspective][j * TileHeight]);
             for (IndexType k = 0; k < NumRegs; ++k)
               vec_store(&accTile[k], acc[k]);
           }
@@ -432,7 +856,7 @@ namespace Stockfish::Eval::NNUE {
         {
           // Load accumulator
           auto accTilePsqt = reinterpret_cast<psqt_vec_t*>(
-            &st->accumulator.psqtAccumulation[perspective][j * PsqtTileHeight]);
+            &(st->*accPtr).psqtAccumulation[perspective][j * PsqtTileHeight]);
           for (std::size_t k = 0; k < NumPsqtRegs; ++k)
             psqt[k] = vec_load_psqt(&accTilePsqt[k]);
 
@@ -458,7 +882,7 @@ namespace Stockfish::Eval::NNUE {
 
             // Store accumulator
             accTilePsqt = reinterpret_cast<psqt_vec_t*>(
-              &states_to_update[i]->accumulator.psqtAccumulation[perspective][j * PsqtTileHeight]);
+              &(states_to_update[i]->*accPtr).psqtAccumulation[perspective][j * PsqtTileHeight]);
             for (std::size_t k = 0; k < NumPsqtRegs; ++k)
               vec_store_psqt(&accTilePsqt[k], psqt[k]);
           }
@@ -467,37 +891,31 @@ namespace Stockfish::Eval::NNUE {
   #else
         for (IndexType i = 0; states_to_update[i]; ++i)
         {
-          std::memcpy(states_to_update[i]->accumulator.accumulation[perspective],
-              st->accumulator.accumulation[perspective],
+          std::memcpy((states_to_update[i]->*accPtr).accumulation[perspective],
+              (st->*accPtr).accumulation[perspective],
               HalfDimensions * sizeof(BiasType));
 
           for (std::size_t k = 0; k < PSQTBuckets; ++k)
-            states_to_update[i]->accumulator.psqtAccumulation[perspective][k] = st->accumulator.psqtAccumulation[perspective][k];
+            (states_to_update[i]->*accPtr).psqtAccumulation[perspective][k] = (st->*accPtr).psqtAccumulation[perspective][k];
 
           st = states_to_update[i];
 
           // Difference calculation for the deactivated features
           for (const auto index : removed[i])
           {
-            const IndexType offset = HalfDimensions * index;
-
-            for (IndexType j = 0; j < HalfDimensions; ++j)
-              st->accumulator.accumulation[perspective][j] -= weights[offset + j];
+            apply_column<false>((st->*accPtr).accumulation[perspective], HalfDimensions * index);
 
             for (std::size_t k = 0; k < PSQTBuckets; ++k)
-              st->accumulator.psqtAccumulation[perspective][k] -= psqtWeights[index * PSQTBuckets + k];
+              (st->*accPtr).psqtAccumulation[perspective][k] -= psqtWeights[index * PSQTBuckets + k];
           }
 
           // Difference calculation for the activated features
           for (const auto index : added[i])
           {
-            const IndexType offset = HalfDimensions * index;
-
-            for (IndexType j = 0; j < HalfDimensions; ++j)
-              st->accumulator.accumulation[perspective][j] += weights[offset + j];
+            apply_column<true>((st->*accPtr).accumulation[perspective], HalfDimensions * index);
 
             for (std::size_t k = 0; k < PSQTBuckets; ++k)
-              st->accumulator.psqtAccumulation[perspective][k] += psqtWeights[index * PSQTBuckets + k];
+              (st->*accPtr).psqtAccumulation[perspective][k] += psqtWeights[index * PSQTBuckets + k];
           }
         }
   #endif
@@ -505,7 +923,7 @@ namespace Stockfish::Eval::NNUE {
       else
       {
         // Refresh the accumulator
-        auto& accumulator = pos.state()->accumulator;
+        auto& accumulator = pos.state()->*accPtr;
         accumulator.computed[perspective] = true;
         FeatureSet::IndexList active;
         FeatureSet::append_active_indices(pos, perspective, active);
@@ -519,13 +937,7 @@ namespace Stockfish::Eval::NNUE {
             acc[k] = biasesTile[k];
 
           for (const auto index : active)
-          {
-            const IndexType offset = HalfDimensions * index + j * TileHeight;
-            auto column = reinterpret_cast<const vec_t*>(&weights[offset]);
-
-            for (unsigned k = 0; k < NumRegs; ++k)
-              acc[k] = vec_add_16(acc[k], column[k]);
-          }
+            apply_column<true>(acc, HalfDimensions * index + j * TileHeight);
 
           auto accTile = reinterpret_cast<vec_t*>(
               &accumulator.accumulation[perspective][j * TileHeight]);
@@ -562,10 +974,7 @@ namespace Stockfish::Eval::NNUE {
 
         for (const auto index : active)
         {
-          const IndexType offset = HalfDimensions * index;
-
-          for (IndexType j = 0; j < HalfDimensions; ++j)
-            accumulator.accumulation[perspective][j] += weights[offset + j];
+          apply_column<true>(accumulator.accumulation[perspective], HalfDimensions * index);
 
           for (std::size_t k = 0; k < PSQTBuckets; ++k)
             accumulator.psqtAccumulation[perspective][k] += psqtWeights[index * PSQTBuckets + k];
@@ -579,8 +988,14 @@ namespace Stockfish::Eval::NNUE {
     }
 
     alignas(CacheLineSize) BiasType biases[HalfDimensions];
-    alignas(CacheLineSize) WeightType weights[HalfDimensions * InputDimensions];
+    // The int8 weights of compact nets are stored in the first half of the
+    // int16 weight array, so that only half of it is touched by the updates.
+    union {
+      alignas(CacheLineSize) WeightType weights[HalfDimensions * InputDimensions];
+      alignas(CacheLineSize) CompactWeightType compactWeights[HalfDimensions * InputDimensions];
+    };
     alignas(CacheLineSize) PSQTWeightType psqtWeights[InputDimensions * PSQTBuckets];
+    bool compactFormat;
   };
 
 }  // namespace Stockfish::Eval::NNUE
@@ -0,0 +1,551 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "engine.h"
+#include "movegen.h"
+#include "pns.h"
+#include "search.h"
+#include "thread.h"
+#include "uci.h"
+
+namespace Stockfish {
+
+namespace PNS {
+
+namespace {
+
+  // Proof and disproof numbers of the proved and disproved nodes. The sums of
+  // the other numbers are kept below this.
+  constexpr uint32_t Infinite = 1 << 30;
+
+  // Node budget of the verification of a mate score, and of the search of a
+  // missing part of a proof
+  constexpr uint64_t VerifyNodes = 1000000;
+
+  // Node budget of search() when the main thread searches alone without a time
+  // limit, about a couple of seconds
+  constexpr uint64_t UntimedNodes = 4000000;
+
+  // Distance of the mate when the proof is not in the table anymore
+  constexpr int Unknown = 2 * MAX_PLY;
+
+  // key() mixes the number of plies left into the key of a position
+  Key key(const Position& pos, int depth) {
+    return pos.key() ^ (uint64_t(depth + 1) * 0x9E3779B97F4A7C15ULL);
+  }
+
+  // The attacker is to move when an odd number of plies is left
+  bool attacker(int depth) { return depth & 1; }
+
+} // namespace
+
+
+/// Table::resize() sets the size of the table in megabytes. Like the MCTS node
+/// table, it is only allocated when it changes, before the first search that
+/// needs it.
+
+void Table::resize(size_t mb) {
+
+  if (mb == mbSize)
+      return;
+
+  aligned_large_pages_free(table);
+
+  mbSize = mb;
+  clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
+  table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
+
+  if (!table)
+  {
+      std::cerr << "Failed to allocate " << mbSize
+                << "MB for the proof-number table." << std::endl;
+      exit(EXIT_FAILURE);
+  }
+}
+
+
+/// Table::clear() empties the table before a new search, since the positions
+/// drawn by repetition are stored as disproved, which depends on the game.
+
+void Table::clear() {
+
+  std::memset(static_cast<void*>(table), 0, clusterCount * sizeof(Cluster));
+}
+
+
+/// Table::probe() returns the entry of the given key and sets found to true if
+/// there is one. Otherwise it returns the entry of its cluster with the least
+/// work, to be replaced.
+
+Entry* Table::probe(Key key, bool& found) const {
+
+  Entry* const e = table[mul_hi64(key, clusterCount)].entry;
+  Entry* replace = e;
+
+  for (int i = 0; i < ClusterSize; ++i)
+  {
+      if (e[i].key == key)
+          return found = true, &e[i];
+
+      if (e[i].work < replace->work)
+          replace = &e[i];
+  }
+
+  return found = false, replace;
+}
+
+
+/// Solver::new_search() decides if the main thread starts with the proof-number
+/// search, which is the case for "go mate" with the "PNS" option.
+
+void Solver::new_search(MainThread& th) {
+
+  Engine& engine = th.engine;
+
+  isActive =   engine.options["PNS"]
+            && engine.limits.mate > 0
+            && !th.rootMoves.empty();
+
+  proved = false;
+
+  if (!isActive)
+      return;
+
+  const Search::LimitsType& limits = engine.limits;
+
+  mainThread = &th;
+  nodes = 0;
+  deadline =  engine.threads.size() > 1 ? 0
+            : limits.movetime             ? limits.movetime / 2
+            : limits.use_time_management() ? engine.time.optimum() / 2 : 0;
+
+  // Alone and without a deadline, the main thread must still leave room for the
+  // iterative deepening, or a "stop" would find no searched root move.
+  nodeLimit = engine.threads.size() == 1 && !deadline ? UntimedNodes : 0;
+  rootMoves.clear();
+  for (const auto& rm : th.rootMoves)
+      rootMoves.push_back(rm.pv[0]);
+
+  table.resize(size_t(engine.options["PNS Hash"]));
+  table.clear();
+}
+
+
+/// Solver::search() tries to prove a mate within the number of moves of "go
+/// mate", and then shorter ones, each try getting as many nodes as were
+/// searched before it. It returns false when there is no such mate, or when it
+/// runs out of its share of the time or of its nodes, in which case the main
+/// thread goes on with the iterative deepening like the other threads.
+
+bool Solver::search(MainThread& th) {
+
+  Engine& engine = th.engine;
+  Position& pos = th.rootPos;
+  int depth = 2 * engine.limits.mate - 1;
+
+  Numbers r = prove(pos, depth);
+  int plies = r.phi == 0 ? set_proof(th, depth) : 0;
+
+  if (!plies)
+  {
+      engine.output("info string PNS " + std::string(r.phi == Infinite ? "no" : "unproved")
+                    + " mate in " + std::to_string(engine.limits.mate) + " in " + std::to_string(nodes)
+                    + " nodes " + std::to_string(engine.time.elapsed()) + " ms");
+      return engine.threads.stop;
+  }
+
+  while (plies > 1 && !engine.threads.stop)
+  {
+      nodeLimit = 2 * nodes;
+      r = prove(pos, plies - 2);
+      nodeLimit = 0;
+
+      int shorter = r.phi == 0 ? set_proof(th, plies - 2) : 0;
+      if (!shorter)
+          break;
+
+      plies = shorter;
+  }
+
+  engine.output("info string PNS mate " + std::to_string((plies + 1) / 2) + " proved in "
+                + std::to_string(nodes) + " nodes " + std::to_string(engine.time.elapsed()) + " ms");
+  return true;
+}
+
+
+/// Solver::set_proof() sets the mate proved within the given number of plies
+/// as the best root move, with the distance and the PV of the proof, reports
+/// it and returns the distance. It returns 0 without setting anything if the
+/// first move of the proof is not found.
+
+int Solver::set_proof(MainThread& th, int depth) {
+
+  Position& pos = th.rootPos;
+  std::unordered_map<Key, int> distances;
+  std::vector<Move> pv = proof(pos, depth, distances);
+  distances.clear();
+  int plies = std::min(distance(pos, 0, depth, distances), depth);
+
+  // The root is stored last, so its entry should be there
+  if (pv.empty())
+  {
+      bool found;
+      Entry* e = table.probe(key(pos, depth), found);
+      if (!found)
+          return 0;
+
+      pv.push_back(e->move);
+  }
+
+  auto it = std::find(th.rootMoves.begin(), th.rootMoves.end(), pv[0]);
+  if (it == th.rootMoves.end())
+      return 0;
+
+  std::rotate(th.rootMoves.begin(), it, it + 1);
+
+  Search::RootMove& rm = th.rootMoves[0];
+  rm.score = rm.averageScore = mate_in(plies);
+  rm.selDepth = int(pv.size());
+  rm.pv = pv;
+  th.rootDepth = th.completedDepth = plies;
+  proved = true;
+
+  th.engine.output(UCI::pv(pos, th.completedDepth, -VALUE_INFINITE, VALUE_INFINITE));
+  return plies;
+}
+
+
+/// Solver::verify() checks with a proof-number search the mate score of the
+/// best root move of a search, within a node budget, and reports the result.
+/// The mates already proved by search() are not checked again.
+
+void Solver::verify(MainThread& th, const Search::RootMove& rm) {
+
+  Engine& engine = th.engine;
+
+  if (   !engine.options["PNS Verify"]
+      ||  proved
+      ||  rm.score < VALUE_MATE_IN_MAX_PLY
+      ||  rm.pv[0] == MOVE_NONE)
+      return;
+
+  int n = (VALUE_MATE - rm.score + 1) / 2;
+  TimePoint start = now();
+  StateInfo st;
+
+  table.resize(size_t(engine.options["PNS Hash"]));
+  table.clear();
+  mainThread = &th;
+  rootMoves.clear();
+  nodes = 0;
+  nodeLimit = VerifyNodes;
+  untimed = true;
+
+  // The move of the PV is checked, so the defender is to move at the root
+  Position& pos = th.rootPos;
+  pos.do_move(rm.pv[0], st);
+  Numbers r = prove(pos, 2 * n - 2);
+  pos.undo_move(rm.pv[0]);
+  nodeLimit = 0;
+  untimed = false;
+
+  std::string result =  r.phi == Infinite ? "verified"
+                      : r.phi == 0        ? "refuted"
+                                          : "not verified";
+
+  engine.output("info string PNS mate " + std::to_string(n) + " " + result + " in "
+                + std::to_string(nodes) + " nodes " + std::to_string(now() - start) + " ms");
+}
+
+
+/// Solver::prove() searches a position until it is proved or disproved, or the
+/// search is stopped.
+
+Solver::Numbers Solver::prove(Position& pos, int depth) {
+
+  Numbers r = evaluate(pos, 0, depth);
+
+  // Only the positions with moves to search are not decided by evaluate()
+  if (r.phi != 0 && r.phi != Infinite)
+      r = mid(pos, 0, depth, Infinite, Infinite);
+
+  return r;
+}
+
+
+/// Solver::mid() is the recursive df-pn search. It searches a node until its
+/// phi or delta reaches the given thresholds, going down the child with the
+/// lowest delta with the thresholds that would make another child the best
+/// one, and stores its numbers in the table.
+
+Solver::Numbers Solver::mid(Position& pos, int ply, int depth, uint32_t thPhi, uint32_t thDelta) {
+
+  struct Child { Move move; Numbers n; };
+
+  std::vector<Child> children;
+  uint64_t startNodes = nodes;
+  StateInfo st;
+
+  for (Move m : moves(pos, ply, depth))
+  {
+      Entry* e;
+      pos.do_move(m, st);
+      children.push_back({ m, child(pos, ply + 1, depth - 1, e) });
+      pos.undo_move(m);
+  }
+
+  if (children.empty())
+      return evaluate(pos, ply, depth);
+
+  while (true)
+  {
+      Numbers n = { Infinite, 0 };
+      uint32_t delta2 = Infinite;
+      Child* best = &children[0];
+
+      for (Child& c : children)
+      {
+          n.phi = std::min(n.phi, c.n.delta);
+          n.delta =  c.n.phi >= Infinite || n.delta >= Infinite ? Infinite
+                   : std::min(n.delta + c.n.phi, Infinite - 1);
+
+          if (c.n.delta < best->n.delta)
+          {
+              delta2 = best->n.delta;
+              best = &c;
+          }
+          else if (&c != best && c.n.delta < delta2)
+              delta2 = c.n.delta;
+      }
+
+      if (n.phi >= thPhi || n.delta >= thDelta)
+      {
+          bool found;
+          Entry* e = table.probe(key(pos, depth), found);
+          e->key = key(pos, depth);
+          e->phi = n.phi;
+          e->delta = n.delta;
+          e->work = uint32_t(std::min(nodes - startNodes, uint64_t(UINT32_MAX)));
+          e->move = best->move;
+          return n;
+      }
+
+      // The numbers of an unfinished search are not stored
+      if (stopped())
+          return n;
+
+      int64_t childThPhi = int64_t(thDelta) + best->n.phi - n.delta;
+      uint32_t childThDelta = std::min(thPhi, delta2 + 1);
+
+      pos.do_move(best->move, st);
+      best->n = mid(pos, ply + 1, depth - 1, uint32_t(std::clamp(childThPhi, int64_t(1), int64_t(Infinite))), childThDelta);
+      pos.undo_move(best->move);
+  }
+}
+
+
+/// Solver::evaluate() returns the numbers of a new node. The nodes where the
+/// side to move wins or loses get 0 or Infinite, the others get phi 1 and their
+/// number of moves as delta, since the side to move needs a single good move
+/// and the other side must refute them all.
+
+Solver::Numbers Solver::evaluate(Position& pos, int ply, int depth) {
+
+  // A draw is a win for the defender
+  if (ply && pos.is_draw(ply))
+      return attacker(depth) ? Numbers{ Infinite, 0 } : Numbers{ 0, Infinite };
+
+  size_t count = moves(pos, ply, depth).size();
+
+  if (attacker(depth))
+      return count ? Numbers{ 1, uint32_t(count) } : Numbers{ Infinite, 0 };
+
+  if (!count)
+      return pos.checkers() ? Numbers{ Infinite, 0 } : Numbers{ 0, Infinite };
+
+  // The defender escapes if it is not mated when no ply is left
+  return depth ? Numbers{ 1, uint32_t(count) } : Numbers{ 0, Infinite };
+}
+
+
+/// Solver::child() returns the numbers of a child from its table entry, which
+/// is set to nullptr if there is none, or from evaluate().
+
+Solver::Numbers Solver::child(Position& pos, int ply, int depth, Entry*& e) {
+
+  bool found;
+  Entry* entry = table.probe(key(pos, depth), found);
+  e = found ? entry : nullptr;
+  nodes++;
+
+  return found ? Numbers{ e->phi, e->delta } : evaluate(pos, ply, depth);
+}
+
+
+/// Solver::moves() returns the moves searched at a node: the root moves at the
+/// root of search(), and the legal moves elsewhere, only the checks being tried
+/// for a mate in one.
+
+std::vector<Move> Solver::moves(Position& pos, int ply, int depth) {
+
+  std::vector<Move> list;
+
+  if (!ply && !rootMoves.empty())
+      list = rootMoves;
+  else
+      for (const auto& m : MoveList<LEGAL>(pos))
+          list.push_back(m);
+
+  if (depth == 1)
+      list.erase(std::remove_if(list.begin(), list.end(),
+                                [&](Move m) { return !pos.gives_check(m); }), list.end());
+
+  return list;
+}
+
+
+/// Solver::distance() returns the number of plies to the mate in the proof of
+/// a proved node, found in the table: the shortest one over the proved moves
+/// of the attacker, and the longest one over the moves of the defender. It
+/// returns Unknown when a part of the proof is missing from the table.
+
+int Solver::distance(Position& pos, int ply, int depth, std::unordered_map<Key, int>& distances) {
+
+  auto it = distances.find(key(pos, depth));
+  if (it != distances.end())
+      return it->second;
+
+  std::vector<Move> list = moves(pos, ply, depth);
+  int d = attacker(depth) || (list.empty() && !pos.checkers()) ? Unknown : 0;
+  StateInfo st;
+
+  for (Move m : list)
+  {
+      Entry* e;
+      pos.do_move(m, st);
+      bool isProved = child(pos, ply + 1, depth - 1, e).phi == (attacker(depth) ? Infinite : 0);
+      int cd = isProved ? std::min(1 + distance(pos, ply + 1, depth - 1, distances), Unknown) : Unknown;
+      pos.undo_move(m);
+
+      d = attacker(depth) ? std::min(d, cd) : std::max(d, cd);
+
+      if (d == Unknown && !attacker(depth))
+          break;
+  }
+
+  return distances[key(pos, depth)] = d;
+}
+
+
+/// Solver::proof() returns the PV of a proved mate: the moves of the attacker
+/// with the shortest proved mate, and those of the defender that delay it the
+/// most.
+
+std::vector<Move> Solver::proof(Position& pos, int depth, std::unordered_map<Key, int>& distances) {
+
+  std::vector<Move> pv;
+  std::vector<StateInfo> states(depth);
+
+  for (int ply = 0, searched = -1; ply < depth; ++ply)
+  {
+      Move best = MOVE_NONE;
+      int bestDistance = 0;
+
+      for (Move m : moves(pos, ply, depth - ply))
+      {
+          Entry* e;
+          pos.do_move(m, states[ply]);
+          bool isProved = child(pos, ply + 1, depth - ply - 1, e).phi == (attacker(depth - ply) ? Infinite : 0);
+          int d = isProved ? distance(pos, ply + 1, depth - ply - 1, distances) : Unknown;
+          pos.undo_move(m);
+
+          if (   isProved
+              && (   best == MOVE_NONE
+                  || (attacker(depth - ply) ? d < bestDistance : d > bestDistance)))
+          {
+              best = m;
+              bestDistance = d;
+          }
+      }
+
+      // A part of the proof may have been replaced in the table, or stored as
+      // disproved after a repetition on another path. The node is then searched
+      // again, once, on the path of the PV.
+      if (best == MOVE_NONE && searched != ply)
+      {
+          searched = ply--;
+          research(pos, ply + 1, depth - ply - 1);
+          distances.clear();
+          continue;
+      }
+
+      if (best == MOVE_NONE)
+          break;
+
+      pv.push_back(best);
+      pos.do_move(best, states[ply]);
+  }
+
+  for (auto it = pv.rbegin(); it != pv.rend(); ++it)
+      pos.undo_move(*it);
+
+  return pv;
+}
+
+
+/// Solver::research() searches again a node of a proof, within a node budget
+/// and regardless of the time, to store the missing part of the proof.
+
+void Solver::research(Position& pos, int ply, int depth) {
+
+  uint64_t limit = nodeLimit;
+  bool timed = !untimed;
+
+  nodeLimit = nodes + VerifyNodes;
+  untimed = true;
+  mid(pos, ply, depth, Infinite, Infinite);
+  nodeLimit = limit;
+  untimed = !timed;
+}
+
+
+/// Solver::stopped() is true when the node budget is spent, when the search is
+/// stopped, or when the main thread searches alone and has used half of its
+/// time, which leaves the other half to the alpha-beta search.
+
+bool Solver::stopped() {
+
+  if (nodeLimit && nodes >= nodeLimit)
+      return true;
+
+  if (untimed)
+      return false;
+
+  mainThread->check_time();
+  return    mainThread->engine.threads.stop
+         || (deadline && mainThread->engine.time.elapsed() >= deadline);
+}
+
+} // namespace PNS
+
+} // namespace Stockfish
@@ -0,0 +1,120 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PNS_H_INCLUDED
+#define PNS_H_INCLUDED
+
+#include <unordered_map>
+#include <vector>
+
+#include "misc.h"
+#include "position.h"
+#include "types.h"
+
+namespace Stockfish {
+
+class MainThread;
+
+namespace Search { struct RootMove; }
+
+namespace PNS {
+
+/// Entry is an entry of the proof-number table. A position is stored with the
+/// number of plies left for the mate, mixed into its key, since it may be a
+/// mate within some plies and not within fewer. The proof and disproof numbers
+/// are stored as phi and delta, from the point of view of the side to move:
+/// phi is the proof number where the attacker is to move and the disproof
+/// number where the defender is, and delta is the other one. 'work' is the
+/// number of nodes searched for the entry, the entries with the least work
+/// being replaced first.
+
+struct Entry {
+  Key key;
+  uint32_t phi, delta;
+  uint32_t work;
+  Move move;
+};
+
+
+/// Table is the transposition table of the proof-number search, allocated when
+/// the first search needs it with the size of the "PNS Hash" option.
+
+class Table {
+
+  static constexpr int ClusterSize = 4;
+
+  struct Cluster {
+    Entry entry[ClusterSize];
+  };
+
+public:
+ ~Table() { aligned_large_pages_free(table); }
+  void resize(size_t mbSize);
+  void clear();
+  Entry* probe(Key key, bool& found) const;
+
+private:
+  size_t clusterCount = 0;
+  size_t mbSize = 0;
+  Cluster* table = nullptr;
+};
+
+
+/// Solver is a depth-first proof-number search (df-pn) for the mates within a
+/// given number of moves. With the "PNS" option, search() replaces the
+/// iterative deepening of the main thread for "go mate", while the other
+/// threads search as usual. With "PNS Verify", verify() checks the mate scores
+/// of the alpha-beta search at the end of the searches.
+
+class Solver {
+
+  struct Numbers { uint32_t phi, delta; };
+
+public:
+  void new_search(MainThread& mainThread);
+  bool search(MainThread& mainThread);
+  void verify(MainThread& mainThread, const Search::RootMove& rm);
+  bool active() const { return isActive; }
+
+private:
+  Numbers prove(Position& pos, int depth);
+  Numbers mid(Position& pos, int ply, int depth, uint32_t thPhi, uint32_t thDelta);
+  Numbers evaluate(Position& pos, int ply, int depth);
+  Numbers child(Position& pos, int ply, int depth, Entry*& e);
+  std::vector<Move> moves(Position& pos, int ply, int depth);
+  int distance(Position& pos, int ply, int depth, std::unordered_map<Key, int>& distances);
+  std::vector<Move> proof(Position& pos, int depth, std::unordered_map<Key, int>& distances);
+  int set_proof(MainThread& th, int depth);
+  void research(Position& pos, int ply, int depth);
+  bool stopped();
+
+  Table table;
+  MainThread* mainThread;
+  std::vector<Move> rootMoves;
+  bool isActive = false;
+  bool proved;
+  bool untimed = false;
+  uint64_t nodes, nodeLimit;
+  TimePoint deadline;
+};
+
+} // namespace PNS
+
+} // namespace Stockfish
+
+#endif // #ifndef PNS_H_INCLUDED
@@ -24,6 +24,7 @@
 #include <sstream>
 
 #include "bitboard.h"
+#include "engine.h"
 #include "misc.h"
 #include "movegen.h"
 #include "position.h"
@@ -702,8 +703,10 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
   ++st->pliesFromNull;
 
   // Used by NNUE
-  st->accumulator.computed[WHITE] = false;
-  st->accumulator.computed[BLACK] = false;
+  st->accumulatorBig.computed[WHITE] = false;
+  st->accumulatorBig.computed[BLACK] = false;
+  st->accumulatorSmall.computed[WHITE] = false;
+  st->accumulatorSmall.computed[BLACK] = false;
   auto& dp = st->dirtyPiece;
   dp.dirty_num = 1;
 
@@ -889,6 +892,14 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
       }
   }
 
+  // In eager mode the accumulators are updated right away from the parent
+  if (Eval::useNNUE && Eval::NNUE::eagerUpdate)
+      Eval::NNUE::update_eager(*this);
+
+  // Otherwise we may warm up the weight columns the lazy update will need
+  else if (Eval::useNNUE && Eval::NNUE::prefetchColumns)
+      Eval::NNUE::prefetch_columns(*this);
+
   assert(pos_is_ok());
 }
 
@@ -996,15 +1007,17 @@ void Position::do_null_move(StateInfo& newSt) {
   assert(!checkers());
   assert(&newSt != st);
 
-  std::memcpy(&newSt, st, offsetof(StateInfo, accumulator));
+  std::memcpy(&newSt, st, offsetof(StateInfo, accumulatorBig));
 
   newSt.previous = st;
   st = &newSt;
 
   st->dirtyPiece.dirty_num = 0;
   st->dirtyPiece.piece[0] = NO_PIECE; // Avoid checks in UpdateAccumulator()
-  st->accumulator.computed[WHITE] = false;
-  st->accumulator.computed[BLACK] = false;
+  st->accumulatorBig.computed[WHITE] = false;
+  st->accumulatorBig.computed[BLACK] = false;
+  st->accumulatorSmall.computed[WHITE] = false;
+  st->accumulatorSmall.computed[BLACK] = false;
 
   if (st->epSquare != SQ_NONE)
   {
@@ -1014,7 +1027,7 @@ void Position::do_null_move(StateInfo& newSt) {
 
   st->key ^= Zobrist::side;
   ++st->rule50;
-  prefetch(TT.first_entry(key()));
+  prefetch(thisThread->engine.tt.first_entry(key()));
 
   st->pliesFromNull = 0;
 
@@ -23,6 +23,7 @@
 #include <iostream>
 #include <sstream>
 
+#include "engine.h"
 #include "evaluate.h"
 #include "misc.h"
 #include "movegen.h"
@@ -37,19 +38,6 @@
 
 namespace Stockfish {
 
-namespace Search {
-
-  LimitsType Limits;
-}
-
-namespace Tablebases {
-
-  int Cardinality;
-  bool RootInTB;
-  bool UseRule50;
-  Depth ProbeDepth;
-}
-
 namespace TB = Tablebases;
 
 using std::string;
@@ -66,12 +54,11 @@ namespace {
     return Value(168 * (d - improving));
   }
 
-  // Reductions lookup table, initialized at startup
-  int Reductions[MAX_MOVES]; // [depth or moveNumber]
-
-  Depth reduction(bool i, Depth d, int mn, Value delta, Value rootDelta) {
-    int r = Reductions[d] * Reductions[mn];
-    return (r + 1463 - int(delta) * 1024 / int(rootDelta)) / 1024 + (!i && r > 1010);
+  // Reductions lookup table of the thread pool, see Search::init()
+  Depth reduction(const Thread* th, bool i, Depth d, int mn, Value delta) {
+    const int* reductions = th->engine.threads.reductions;
+    int r = reductions[d] * reductions[mn];
+    return (r + 1463 - int(delta) * 1024 / int(th->rootDelta)) / 1024 + (!i && r > 1010);
   }
 
   constexpr int futility_move_count(bool improving, Depth depth) {
@@ -102,7 +89,7 @@ namespace {
     }
     bool enabled() const { return level < 20.0; }
     bool time_to_pick(Depth depth) const { return depth == 1 + int(level); }
-    Move pick_best(size_t multiPV);
+    Move pick_best(const RootMoves& rootMoves, size_t multiPV);
 
     double level;
     Move best = MOVE_NONE;
@@ -122,6 +109,32 @@ namespace {
   void update_all_stats(const Position& pos, Stack* ss, Move bestMove, Value bestValue, Value beta, Square prevSq,
                         Move* quietsSearched, int quietCount, Move* capturesSearched, int captureCount, Depth depth);
 
+  // stop_requested() tells if the search of the given thread must be aborted,
+  // either because all the threads are told to stop or, in batch analysis,
+  // because this thread has reached its own limits.
+  bool stop_requested(const Thread* th) {
+    return th->engine.threads.stop.load(std::memory_order_relaxed) || th->analysisStop;
+  }
+
+  // put() appends an integer, little-endian, to a frame of the binary output
+  template<typename T>
+  void put(string& s, T v) {
+    for (size_t i = 0; i < sizeof(T); ++i)
+        s += char(uint64_t(v) >> (8 * i));
+  }
+
+  // frame() builds a frame of the binary output from its payload. The frame
+  // starts with a zero byte, which never starts a text line, then the frame
+  // type and the 16-bit length of the payload.
+  enum FrameType : uint8_t { FRAME_INFO = 1, FRAME_BESTMOVE = 2 };
+
+  string frame(FrameType type, const string& payload) {
+    string s(1, '\0');
+    put(s, type);
+    put(s, uint16_t(payload.size()));
+    return s + payload;
+  }
+
   // perft() is our utility to verify move generation. All the leaf nodes up
   // to the given depth are generated and counted, and the sum is returned.
   template<bool Root>
@@ -145,7 +158,7 @@ namespace {
             pos.undo_move(m);
         }
         if (Root)
-            sync_cout << UCI::move(m, pos.is_chess960()) << ": " << cnt << sync_endl;
+            pos.this_thread()->engine.output(UCI::move(m, pos.is_chess960()) + ": " + std::to_string(cnt));
     }
     return nodes;
   }
@@ -153,25 +166,13 @@ namespace {
 } // namespace
 
 
-/// Search::init() is called at startup to initialize various lookup tables
+/// Search::init() is called when the threads of a pool are created, to
+/// initialize the lookup tables that depend on their number
 
-void Search::init() {
+void Search::init(ThreadPool& threads) {
 
   for (int i = 1; i < MAX_MOVES; ++i)
-      Reductions[i] = int((20.81 + std::log(Threads.size()) / 2) * std::log(i));
-}
-
-
-/// Search::clear() resets search state to its initial value
-
-void Search::clear() {
-
-  Threads.main()->wait_for_search_finished();
-
-  Time.availableNodes = 0;
-  TT.clear();
-  Threads.clear();
-  Tablebases::init(Options["SyzygyPath"]); // Free mapped files
+      threads.reductions[i] = int((20.81 + std::log(threads.size()) / 2) * std::log(i));
 }
 
 
@@ -180,29 +181,34 @@ void Search::clear() {
 
 void MainThread::search() {
 
-  if (Limits.perft)
+  Search::LimitsType& limits = engine.limits;
+  ThreadPool& threads = engine.threads;
+  UCI::OptionsMap& options = engine.options;
+
+  if (limits.perft)
   {
-      nodes = perft<true>(rootPos, Limits.perft);
-      sync_cout << "\nNodes searched: " << nodes << "\n" << sync_endl;
+      nodes = perft<true>(rootPos, limits.perft);
+      engine.output("\nNodes searched: " + std::to_string(nodes) + "\n");
       return;
   }
 
   Color us = rootPos.side_to_move();
-  Time.init(Limits, us, rootPos.game_ply());
-  TT.new_search();
+  engine.time.init(us, rootPos.game_ply(), options);
+  engine.tt.new_search();
 
-  Eval::NNUE::verify();
+  Eval::NNUE::verify(engine);
 
   if (rootMoves.empty())
   {
       rootMoves.emplace_back(MOVE_NONE);
-      sync_cout << "info depth 0 score "
-                << UCI::value(rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW)
-                << sync_endl;
+      engine.output("info depth 0 score "
+                    + UCI::value(rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW));
   }
   else
   {
-      Threads.start_searching(); // start non-main threads
+      engine.mcts.new_search(*this);
+      engine.pns.new_search(*this);
+      threads.start_searching(); // start non-main threads
       Thread::search();          // main thread start searching
   }
 
@@ -212,46 +218,70 @@ void MainThread::search() {
   // GUI sends a "stop" or "ponderhit" command. We therefore simply wait here
   // until the GUI sends one of those commands.
 
-  while (!Threads.stop && (ponder || Limits.infinite))
+  while (!threads.stop && (ponder || limits.infinite))
   {} // Busy wait for a stop or a ponder reset
 
   // Stop the threads if not already stopped (also raise the stop if
   // "ponderhit" just reset Threads.ponder).
-  Threads.stop = true;
+  threads.stop = true;
 
   // Wait until all threads have finished
-  Threads.wait_for_search_finished();
+  threads.wait_for_search_finished();
 
   // When playing in 'nodes as time' mode, subtract the searched nodes from
   // the available ones before exiting.
-  if (Limits.npmsec)
-      Time.availableNodes += Limits.inc[us] - Threads.nodes_searched();
+  if (limits.npmsec)
+      engine.time.availableNodes += limits.inc[us] - threads.nodes_searched();
 
   Thread* bestThread = this;
-  Skill skill = Skill(Options["Skill Level"], Options["UCI_LimitStrength"] ? int(Options["UCI_Elo"]) : 0);
+  Skill skill = Skill(options["Skill Level"], options["UCI_LimitStrength"] ? int(options["UCI_Elo"]) : 0);
 
-  if (   int(Options["MultiPV"]) == 1
-      && !Limits.depth
+  if (   int(options["MultiPV"]) == 1
+      && !limits.depth
       && !skill.enabled()
-      && rootMoves[0].pv[0] != MOVE_NONE)
-      bestThread = Threads.get_best_thread();
+      && rootMoves[0].pv[0] != MOVE_NONE
+      && !engine.mcts.active())
+      bestThread = threads.get_best_thread();
 
   bestPreviousScore = bestThread->rootMoves[0].score;
   bestPreviousAverageScore = bestThread->rootMoves[0].averageScore;
+  bestMove = bestThread->rootMoves[0].pv[0];
 
-  for (Thread* th : Threads)
+  for (Thread* th : threads)
     th->previousDepth = bestThread->completedDepth;
 
-  // Send again PV info if we have a new best thread
-  if (bestThread != this)
-      sync_cout << UCI::pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE) << sync_endl;
+  // Send again PV info if we have a new best thread, or if the last one has
+  // been held back by "Info Interval".
+  if (bestThread != this || engine.info_dropped())
+      engine.output(UCI::pv(bestThread->rootPos, bestThread->completedDepth, -VALUE_INFINITE, VALUE_INFINITE));
 
-  sync_cout << "bestmove " << UCI::move(bestThread->rootMoves[0].pv[0], rootPos.is_chess960());
+  Move best = bestThread->rootMoves[0].pv[0];
+  Move ponderMove = MOVE_NONE;
 
   if (bestThread->rootMoves[0].pv.size() > 1 || bestThread->rootMoves[0].extract_ponder_from_tt(rootPos))
-      std::cout << " ponder " << UCI::move(bestThread->rootMoves[0].pv[1], rootPos.is_chess960());
+      ponderMove = bestThread->rootMoves[0].pv[1];
 
-  std::cout << sync_endl;
+  if (engine.binary_output())
+  {
+      string payload;
+      put(payload, uint16_t(best));
+      put(payload, uint16_t(ponderMove));
+      engine.output(frame(FRAME_BESTMOVE, payload));
+  }
+  else
+  {
+      string bestmove = "bestmove " + UCI::move(best, rootPos.is_chess960());
+
+      if (ponderMove != MOVE_NONE)
+          bestmove += " ponder " + UCI::move(ponderMove, rootPos.is_chess960());
+
+      engine.output(bestmove);
+  }
+
+  // The mate score is verified once the best move is sent, so that the
+  // verification never makes the engine exceed its time.
+  engine.pns.verify(*this, bestThread->rootMoves[0]);
+  engine.mcts.clear();
 }
 
 
@@ -270,7 +300,9 @@ void Thread::search() {
   Value alpha, beta, delta;
   Move  lastBestMove = MOVE_NONE;
   Depth lastBestMoveDepth = 0;
-  MainThread* mainThread = (this == Threads.main() ? Threads.main() : nullptr);
+  Search::LimitsType& limits = engine.limits;
+  ThreadPool& threads = engine.threads;
+  MainThread* mainThread = (this == threads.main() && !analysing ? threads.main() : nullptr);
   double timeReduction = 1, totBestMoveChanges = 0;
   Color us = rootPos.side_to_move();
   int iterIdx = 0;
@@ -297,8 +329,8 @@ void Thread::search() {
               mainThread->iterValue[i] = mainThread->bestPreviousScore;
   }
 
-  size_t multiPV = size_t(Options["MultiPV"]);
-  Skill skill(Options["Skill Level"], Options["UCI_LimitStrength"] ? int(Options["UCI_Elo"]) : 0);
+  size_t multiPV = size_t(engine.options["MultiPV"]);
+  Skill skill(engine.options["Skill Level"], engine.options["UCI_LimitStrength"] ? int(engine.options["UCI_Elo"]) : 0);
 
   // When playing with strength handicap enable MultiPV search that we will
   // use behind the scenes to retrieve a set of possible moves.
@@ -313,12 +345,24 @@ void Thread::search() {
   optimism[ us] = Value(39);
   optimism[~us] = -optimism[us];
 
+  // With MCTS, the tree search replaces the iterative deepening loop
+  if (engine.mcts.active() && !analysing)
+  {
+      engine.mcts.search(*this);
+      return;
+  }
+
+  // With "go mate", the main thread first tries to prove the mate with the
+  // proof-number search, while the other threads search as usual.
+  if (mainThread && engine.pns.active() && engine.pns.search(*mainThread))
+      return;
+
   int searchAgainCounter = 0;
 
   // Iterative deepening loop until requested to stop or the target depth is reached
   while (   ++rootDepth < MAX_PLY
-         && !Threads.stop
-         && !(Limits.depth && mainThread && rootDepth > Limits.depth))
+         && !stop_requested(this)
+         && !(limits.depth && (mainThread || analysing) && rootDepth > limits.depth))
   {
       // Age out PV variability metric
       if (mainThread)
@@ -332,11 +376,11 @@ void Thread::search() {
       size_t pvFirst = 0;
       pvLast = 0;
 
-      if (!Threads.increaseDepth)
+      if (!threads.increaseDepth)
          searchAgainCounter++;
 
       // MultiPV loop. We perform a full root search for each PV line
-      for (pvIdx = 0; pvIdx < multiPV && !Threads.stop; ++pvIdx)
+      for (pvIdx = 0; pvIdx < multiPV && !stop_requested(this); ++pvIdx)
       {
           if (pvIdx == pvLast)
           {
@@ -389,7 +433,7 @@ void Thread::search() {
               // If search has been stopped, we break immediately. Sorting is
               // safe because RootMoves is still valid, although it refers to
               // the previous iteration.
-              if (Threads.stop)
+              if (stop_requested(this))
                   break;
 
               // When failing high/low give some update (without cluttering
@@ -397,8 +441,9 @@ void Thread::search() {
               if (   mainThread
                   && multiPV == 1
                   && (bestValue <= alpha || bestValue >= beta)
-                  && Time.elapsed() > 3000)
-                  sync_cout << UCI::pv(rootPos, rootDepth, alpha, beta) << sync_endl;
+                  && engine.time.elapsed() > 3000
+                  && engine.info_allowed())
+                  engine.output(UCI::pv(rootPos, rootDepth, alpha, beta));
 
               // In case of failing low/high increase aspiration window and
               // re-search, otherwise exit the loop.
@@ -428,11 +473,12 @@ void Thread::search() {
           std::stable_sort(rootMoves.begin() + pvFirst, rootMoves.begin() + pvIdx + 1);
 
           if (    mainThread
-              && (Threads.stop || pvIdx + 1 == multiPV || Time.elapsed() > 3000))
-              sync_cout << UCI::pv(rootPos, rootDepth, alpha, beta) << sync_endl;
+              && (threads.stop || pvIdx + 1 == multiPV || engine.time.elapsed() > 3000)
+              && engine.info_allowed())
+              engine.output(UCI::pv(rootPos, rootDepth, alpha, beta));
       }
 
-      if (!Threads.stop)
+      if (!stop_requested(this))
           completedDepth = rootDepth;
 
       if (rootMoves[0].pv[0] != lastBestMove) {
@@ -441,28 +487,28 @@ void Thread::search() {
       }
 
       // Have we found a "mate in x"?
-      if (   Limits.mate
+      if (   limits.mate
           && bestValue >= VALUE_MATE_IN_MAX_PLY
-          && VALUE_MATE - bestValue <= 2 * Limits.mate)
-          Threads.stop = true;
+          && VALUE_MATE - bestValue <= 2 * limits.mate)
+          threads.stop = true;
 
       if (!mainThread)
           continue;
 
       // If skill level is enabled and time is up, pick a sub-optimal best move
       if (skill.enabled() && skill.time_to_pick(rootDepth))
-          skill.pick_best(multiPV);
+          skill.pick_best(rootMoves, multiPV);
 
       // Use part of the gained time from a previous stable move for the current move
-      for (Thread* th : Threads)
+      for (Thread* th : threads)
       {
           totBestMoveChanges += th->bestMoveChanges;
           th->bestMoveChanges = 0;
       }
 
       // Do we have time for the next iteration? Can we stop searching now?
-      if (    Limits.use_time_management()
-          && !Threads.stop
+      if (    limits.use_time_management()
+          && !threads.stop
           && !mainThread->stopOnPonderhit)
       {
           double fallingEval = (69 + 12 * (mainThread->bestPreviousAverageScore - bestValue)
@@ -472,11 +518,11 @@ void Thread::search() {
           // If the bestMove is stable over several iterations, reduce time accordingly
           timeReduction = lastBestMoveDepth + 10 < completedDepth ? 1.63 : 0.73;
           double reduction = (1.56 + mainThread->previousTimeReduction) / (2.20 * timeReduction);
-          double bestMoveInstability = 1 + 1.7 * totBestMoveChanges / Threads.size();
+          double bestMoveInstability = 1 + 1.7 * totBestMoveChanges / threads.size();
           int complexity = mainThread->complexityAverage.value();
           double complexPosition = std::min(1.0 + (complexity - 277) / 1819.1, 1.5);
 
-          double totalTime = Time.optimum() * fallingEval * reduction * bestMoveInstability * complexPosition;
+          double totalTime = engine.time.optimum() * fallingEval * reduction * bestMoveInstability * complexPosition;
 
           // Cap used time in case of a single legal move for a better viewer experience in tournaments
           // yielding correct scores and sufficiently fast moves.
@@ -484,21 +530,21 @@ void Thread::search() {
               totalTime = std::min(500.0, totalTime);
 
           // Stop the search if we have exceeded the totalTime
-          if (Time.elapsed() > totalTime)
+          if (engine.time.elapsed() > totalTime)
           {
               // If we are allowed to ponder do not stop the search now but
               // keep pondering until the GUI sends "ponderhit" or "stop".
               if (mainThread->ponder)
                   mainThread->stopOnPonderhit = true;
               else
-                  Threads.stop = true;
+                  threads.stop = true;
           }
-          else if (   Threads.increaseDepth
+          else if (   threads.increaseDepth
                    && !mainThread->ponder
-                   && Time.elapsed() > totalTime * 0.43)
-                   Threads.increaseDepth = false;
+                   && engine.time.elapsed() > totalTime * 0.43)
+                   threads.increaseDepth = false;
           else
-                   Threads.increaseDepth = true;
+                   threads.increaseDepth = true;
       }
 
       mainThread->iterValue[iterIdx] = bestValue;
@@ -513,7 +559,7 @@ void Thread::search() {
   // If skill level is enabled, swap best PV line with the sub-optimal one
   if (skill.enabled())
       std::swap(rootMoves[0], *std::find(rootMoves.begin(), rootMoves.end(),
-                skill.best ? skill.best : skill.pick_best(multiPV)));
+                skill.best ? skill.best : skill.pick_best(rootMoves, multiPV)));
 }
 
 
@@ -565,6 +611,7 @@ namespace {
 
     // Step 1. Initialize node
     Thread* thisThread = pos.this_thread();
+    Engine& engine     = thisThread->engine;
     thisThread->depth  = depth;
     ss->inCheck        = pos.checkers();
     priorCapture       = pos.captured_piece();
@@ -574,7 +621,9 @@ namespace {
     maxValue           = VALUE_INFINITE;
 
     // Check for the available remaining time
-    if (thisThread == Threads.main())
+    if (thisThread->analysing)
+        thisThread->check_analysis_limits();
+    else if (thisThread == engine.threads.main())
         static_cast<MainThread*>(thisThread)->check_time();
 
     // Used to send selDepth info to GUI (selDepth counts from 1, ply from 0)
@@ -584,7 +633,7 @@ namespace {
     if (!rootNode)
     {
         // Step 2. Check for aborted search and immediate draw
-        if (   Threads.stop.load(std::memory_order_relaxed)
+        if (   stop_requested(thisThread)
             || pos.is_draw(ss->ply)
             || ss->ply >= MAX_PLY)
             return (ss->ply >= MAX_PLY && !ss->inCheck) ? evaluate(pos)
@@ -626,7 +675,7 @@ namespace {
     // position key in case of an excluded move.
     excludedMove = ss->excludedMove;
     posKey = excludedMove == MOVE_NONE ? pos.key() : pos.key() ^ make_key(excludedMove);
-    tte = TT.probe(posKey, ss->ttHit);
+    tte = engine.tt.probe(posKey, ss->ttHit);
     ttValue = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove =  rootNode ? thisThread->rootMoves[thisThread->pvIdx].pv[0]
             : ss->ttHit    ? tte->move() : MOVE_NONE;
@@ -670,12 +719,12 @@ namespace {
     }
 
     // Step 5. Tablebases probe
-    if (!rootNode && TB::Cardinality)
+    if (!rootNode && engine.tbConfig.cardinality)
     {
         int piecesCount = pos.count<ALL_PIECES>();
 
-        if (    piecesCount <= TB::Cardinality
-            && (piecesCount <  TB::Cardinality || depth >= TB::ProbeDepth)
+        if (    piecesCount <= engine.tbConfig.cardinality
+            && (piecesCount <  engine.tbConfig.cardinality || depth >= engine.tbConfig.probeDepth)
             &&  pos.rule50_count() == 0
             && !pos.can_castle(ANY_CASTLING))
         {
@@ -683,14 +732,14 @@ namespace {
             TB::WDLScore wdl = Tablebases::probe_wdl(pos, &err);
 
             // Force check of time on the next occasion
-            if (thisThread == Threads.main())
+            if (thisThread == engine.threads.main())
                 static_cast<MainThread*>(thisThread)->callsCnt = 0;
 
             if (err != TB::ProbeState::FAIL)
             {
                 thisThread->tbHits.fetch_add(1, std::memory_order_relaxed);
 
-                int drawScore = TB::UseRule50 ? 1 : 0;
+                int drawScore = engine.tbConfig.useRule50 ? 1 : 0;
 
                 // use the range VALUE_MATE_IN_MAX_PLY to VALUE_TB_WIN_IN_MAX_PLY to score
                 value =  wdl < -drawScore ? VALUE_MATED_IN_MAX_PLY + ss->ply + 1
@@ -705,7 +754,7 @@ namespace {
                 {
                     tte->save(posKey, value_to_tt(value, ss->ply), ss->ttPv, b,
                               std::min(MAX_PLY - 1, depth + 6),
-                              MOVE_NONE, VALUE_NONE);
+                              MOVE_NONE, VALUE_NONE, engine.tt.generation());
 
                     return value;
                 }
@@ -757,7 +806,7 @@ namespace {
 
         // Save static evaluation into transposition table
         if (!excludedMove)
-            tte->save(posKey, VALUE_NONE, ss->ttPv, BOUND_NONE, DEPTH_NONE, MOVE_NONE, eval);
+            tte->save(posKey, VALUE_NONE, ss->ttPv, BOUND_NONE, DEPTH_NONE, MOVE_NONE, eval, engine.tt.generation());
     }
 
     thisThread->complexityAverage.update(complexity);
@@ -895,7 +944,8 @@ namespace {
                 if (value >= probCutBeta)
                 {
                     // Save ProbCut data into transposition table
-                    tte->save(posKey, value_to_tt(value, ss->ply), ss->ttPv, BOUND_LOWER, depth - 3, move, ss->staticEval);
+                    tte->save(posKey, value_to_tt(value, ss->ply), ss->ttPv, BOUND_LOWER, depth - 3, move, ss->staticEval,
+                              engine.tt.generation());
                     return value;
                 }
             }
@@ -977,10 +1027,11 @@ moves_loop: // When in check, search starts here
 
       ss->moveCount = ++moveCount;
 
-      if (rootNode && thisThread == Threads.main() && Time.elapsed() > 3000)
-          sync_cout << "info depth " << depth
-                    << " currmove " << UCI::move(move, pos.is_chess960())
-                    << " currmovenumber " << moveCount + thisThread->pvIdx << sync_endl;
+      if (rootNode && thisThread == engine.threads.main() && !thisThread->analysing && engine.time.elapsed() > 3000
+          && engine.info_allowed())
+          engine.output("info depth " + std::to_string(depth)
+                        + " currmove " + UCI::move(move, pos.is_chess960())
+                        + " currmovenumber " + std::to_string(moveCount + thisThread->pvIdx));
       if (PvNode)
           (ss+1)->pv = nullptr;
 
@@ -1003,7 +1054,7 @@ moves_loop: // When in check, search starts here
           moveCountPruning = moveCount >= futility_move_count(improving, depth);
 
           // Reduced depth of the next LMR search
-          int lmrDepth = std::max(newDepth - reduction(improving, depth, moveCount, delta, thisThread->rootDelta), 0);
+          int lmrDepth = std::max(newDepth - reduction(thisThread, improving, depth, moveCount, delta), 0);
 
           if (   capture
               || givesCheck)
@@ -1120,7 +1171,7 @@ moves_loop: // When in check, search starts here
       ss->doubleExtensions = (ss-1)->doubleExtensions + (extension == 2);
 
       // Speculative prefetch as early as possible
-      prefetch(TT.first_entry(pos.key_after(move)));
+      prefetch(engine.tt.first_entry(pos.key_after(move)));
 
       // Update the current move (this must be done after singular extension search)
       ss->currentMove = move;
@@ -1144,7 +1195,7 @@ moves_loop: // When in check, search starts here
               || !capture
               || (cutNode && (ss-1)->moveCount > 1)))
       {
-          Depth r = reduction(improving, depth, moveCount, delta, thisThread->rootDelta);
+          Depth r = reduction(thisThread, improving, depth, moveCount, delta);
 
           // Decrease reduction if position is or has been on the PV
           // and node is not likely to fail low. (~3 Elo)
@@ -1242,7 +1293,7 @@ moves_loop: // When in check, search starts here
       // Finished searching the move. If a stop occurred, the return value of
       // the search cannot be trusted, and we return immediately without
       // updating best move, PV and TT.
-      if (Threads.stop.load(std::memory_order_relaxed))
+      if (stop_requested(thisThread))
           return VALUE_ZERO;
 
       if (rootNode)
@@ -1376,7 +1427,7 @@ moves_loop: // When in check, search starts here
         tte->save(posKey, value_to_tt(bestValue, ss->ply), ss->ttPv,
                   bestValue >= beta ? BOUND_LOWER :
                   PvNode && bestMove ? BOUND_EXACT : BOUND_UPPER,
-                  depth, bestMove, ss->staticEval);
+                  depth, bestMove, ss->staticEval, engine.tt.generation());
 
     assert(bestValue > -VALUE_INFINITE && bestValue < VALUE_INFINITE);
 
@@ -1416,6 +1467,7 @@ moves_loop: // When in check, search starts here
     }
 
     Thread* thisThread = pos.this_thread();
+    Engine& engine = thisThread->engine;
     bestMove = MOVE_NONE;
     ss->inCheck = pos.checkers();
     moveCount = 0;
@@ -1434,7 +1486,7 @@ moves_loop: // When in check, search starts here
                                                   : DEPTH_QS_NO_CHECKS;
     // Transposition table lookup
     posKey = pos.key();
-    tte = TT.probe(posKey, ss->ttHit);
+    tte = engine.tt.probe(posKey, ss->ttHit);
     ttValue = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove = ss->ttHit ? tte->move() : MOVE_NONE;
     pvHit = ss->ttHit && tte->is_pv();
@@ -1477,7 +1529,7 @@ moves_loop: // When in check, search starts here
             // Save gathered info in transposition table
             if (!ss->ttHit)
                 tte->save(posKey, value_to_tt(bestValue, ss->ply), false, BOUND_LOWER,
-                          DEPTH_NONE, MOVE_NONE, ss->staticEval);
+                          DEPTH_NONE, MOVE_NONE, ss->staticEval, engine.tt.generation());
 
             return bestValue;
         }
@@ -1550,7 +1602,7 @@ moves_loop: // When in check, search starts here
           continue;
 
       // Speculative prefetch as early as possible
-      prefetch(TT.first_entry(pos.key_after(move)));
+      prefetch(engine.tt.first_entry(pos.key_after(move)));
 
       ss->currentMove = move;
       ss->continuationHistory = &thisThread->continuationHistory[ss->inCheck]
@@ -1613,7 +1665,7 @@ moves_loop: // When in check, search starts here
     // Save gathered info in transposition table
     tte->save(posKey, value_to_tt(bestValue, ss->ply), pvHit,
               bestValue >= beta ? BOUND_LOWER : BOUND_UPPER,
-              ttDepth, bestMove, ss->staticEval);
+              ttDepth, bestMove, ss->staticEval, engine.tt.generation());
 
     assert(bestValue > -VALUE_INFINITE && bestValue < VALUE_INFINITE);
 
@@ -1765,10 +1817,9 @@ moves_loop: // When in check, search starts here
   // When playing with strength handicap, choose best move among a set of RootMoves
   // using a statistical rule dependent on 'level'. Idea by Heinz van Saanen.
 
-  Move Skill::pick_best(size_t multiPV) {
+  Move Skill::pick_best(const RootMoves& rootMoves, size_t multiPV) {
 
-    const RootMoves& rootMoves = Threads.main()->rootMoves;
-    static PRNG rng(now()); // PRNG sequence should be non-deterministic
+    static thread_local PRNG rng(now()); // PRNG sequence should be non-deterministic
 
     // RootMoves are already sorted by score in descending order
     Value topScore = rootMoves[0].score;
@@ -1806,13 +1857,15 @@ void MainThread::check_time() {
   if (--callsCnt > 0)
       return;
 
+  const Search::LimitsType& limits = engine.limits;
+
   // When using nodes, ensure checking rate is not lower than 0.1% of nodes
-  callsCnt = Limits.nodes ? std::min(1024, int(Limits.nodes / 1024)) : 1024;
+  callsCnt = limits.nodes ? std::min(1024, int(limits.nodes / 1024)) : 1024;
 
-  static TimePoint lastInfoTime = now();
+  static thread_local TimePoint lastInfoTime = now();
 
-  TimePoint elapsed = Time.elapsed();
-  TimePoint tick = Limits.startTime + elapsed;
+  TimePoint elapsed = engine.time.elapsed();
+  TimePoint tick = limits.startTime + elapsed;
 
   if (tick - lastInfoTime >= 1000)
   {
@@ -1824,25 +1877,142 @@ void MainThread::check_time() {
   if (ponder)
       return;
 
-  if (   (Limits.use_time_management() && (elapsed > Time.maximum() - 10 || stopOnPonderhit))
-      || (Limits.movetime && elapsed >= Limits.movetime)
-      || (Limits.nodes && Threads.nodes_searched() >= (uint64_t)Limits.nodes))
-      Threads.stop = true;
+  if (   (limits.use_time_management() && (elapsed > engine.time.maximum() - 10 || stopOnPonderhit))
+      || (limits.movetime && elapsed >= limits.movetime)
+      || (limits.nodes && engine.threads.nodes_searched() >= (uint64_t)limits.nodes))
+      engine.threads.stop = true;
+}
+
+
+/// Thread::check_analysis_limits() is the batch analysis counterpart of
+/// MainThread::check_time(): the node and time limits apply to the position
+/// being searched by this thread only, and reaching them stops this thread only.
+
+void Thread::check_analysis_limits() {
+
+  if (--analysisCalls > 0)
+      return;
+
+  const Search::LimitsType& limits = engine.limits;
+
+  analysisCalls = limits.nodes ? std::min(1024, int(limits.nodes / 1024)) : 1024;
+
+  if (   (limits.movetime && now() - analysisStart >= limits.movetime)
+      || (limits.nodes && nodes.load(std::memory_order_relaxed) >= (uint64_t)limits.nodes))
+      analysisStop = true;
+}
+
+
+/// Search::leaf_search() evaluates a leaf of the tree of MCTS with a full
+/// window search of the given depth from the leaf position, or a quiescence
+/// search at depth 0, and returns the value for the side to move. The search
+/// uses the histories of the thread and the TT as any other search.
+
+Value Search::leaf_search(Position& pos, Depth depth) {
+
+  Thread* thisThread = pos.this_thread();
+  Stack stack[MAX_PLY+10], *ss = stack+7;
+  Move pv[MAX_PLY+1];
+
+  std::memset(ss-7, 0, 10 * sizeof(Stack));
+  for (int i = 7; i > 0; i--)
+      (ss-i)->continuationHistory = &thisThread->continuationHistory[0][0][NO_PIECE][0]; // Use as a sentinel
+
+  for (int i = 0; i <= MAX_PLY + 2; ++i)
+      (ss+i)->ply = i;
+
+  ss->pv = pv;
+  pv[0] = MOVE_NONE;
+
+  thisThread->rootDepth = depth;
+  thisThread->rootDelta = 2 * VALUE_INFINITE;
+  thisThread->nmpMinPly = 0;
+
+  return depth > 0 ? search<PV>(pos, ss, -VALUE_INFINITE, VALUE_INFINITE, depth, false)
+                   : qsearch<PV>(pos, ss, -VALUE_INFINITE, VALUE_INFINITE);
+}
+
+
+/// Thread::analyse() is the batch analysis loop of a thread, started by
+/// ThreadPool::analyse(). The thread takes the next position from the queue,
+/// searches it from scratch with the given limits and prints the result, until
+/// no positions are left.
+
+void Thread::analyse() {
+
+  ThreadPool& threads = engine.threads;
+  const size_t total = threads.analysisFens.size();
+  size_t i;
+
+  while ((i = threads.analysisNext++) < total && !threads.stop)
+  {
+      rootPos.set(threads.analysisFens[i], threads.analysisChess960[i], &rootState, this);
+
+      rootMoves.clear();
+      for (const auto& m : MoveList<LEGAL>(rootPos))
+          rootMoves.emplace_back(m);
+
+      nodes = tbHits = nmpMinPly = bestMoveChanges = 0;
+      rootDepth = completedDepth = selDepth = 0;
+      analysisStop = false;
+      analysisCalls = 1;
+      analysisStart = now();
+
+      if (!rootMoves.empty())
+          Thread::search();
+
+      TimePoint elapsed = now() - analysisStart + 1;
+      size_t done = ++threads.analysisDone;
+      threads.analysisNodes += nodes;
+      std::stringstream ss;
+
+      ss << "position " << i + 1 << "/" << total
+         << " fen "     << threads.analysisFens[i];
+
+      if (rootMoves.empty())
+          ss << " depth 0 score " << UCI::value(rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW)
+             << " bestmove (none)";
+      else
+      {
+          const RootMove& rm = rootMoves[0];
+          Value v = rm.score != -VALUE_INFINITE ? rm.score : rm.previousScore;
+
+          ss << " depth "    << completedDepth
+             << " seldepth " << rm.selDepth
+             << " score "    << UCI::value(v == -VALUE_INFINITE ? VALUE_ZERO : v)
+             << " nodes "    << nodes
+             << " nps "      << nodes * 1000 / elapsed
+             << " time "     << elapsed
+             << " bestmove " << UCI::move(rm.pv[0], rootPos.is_chess960())
+             << " pv";
+
+          for (Move m : rm.pv)
+              ss << " " << UCI::move(m, rootPos.is_chess960());
+      }
+
+      ss << " positions/second " << done * 1000 / double(now() - threads.analysisStart + 1);
+
+      engine.output(ss.str());
+  }
 }
 
 
 /// UCI::pv() formats PV information according to the UCI protocol. UCI requires
 /// that all (if any) unsearched PV lines are sent using a previous search score.
+/// With "Binary Output" each line is replaced by a frame, see README.md.
 
 string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
 
   std::stringstream ss;
-  TimePoint elapsed = Time.elapsed() + 1;
+  string frames;
+  bool binary = pos.this_thread()->engine.binary_output();
+  Engine& engine = pos.this_thread()->engine;
+  TimePoint elapsed = engine.time.elapsed() + 1;
   const RootMoves& rootMoves = pos.this_thread()->rootMoves;
   size_t pvIdx = pos.this_thread()->pvIdx;
-  size_t multiPV = std::min((size_t)Options["MultiPV"], rootMoves.size());
-  uint64_t nodesSearched = Threads.nodes_searched();
-  uint64_t tbHits = Threads.tb_hits() + (TB::RootInTB ? rootMoves.size() : 0);
+  size_t multiPV = std::min((size_t)engine.options["MultiPV"], rootMoves.size());
+  uint64_t nodesSearched = engine.threads.nodes_searched();
+  uint64_t tbHits = engine.threads.tb_hits() + (engine.tbConfig.rootInTB ? rootMoves.size() : 0);
 
   for (size_t i = 0; i < multiPV; ++i)
   {
@@ -1857,9 +2027,37 @@ string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
       if (v == -VALUE_INFINITE)
           v = VALUE_ZERO;
 
-      bool tb = TB::RootInTB && abs(v) < VALUE_MATE_IN_MAX_PLY;
+      bool tb = engine.tbConfig.rootInTB && abs(v) < VALUE_MATE_IN_MAX_PLY;
       v = tb ? rootMoves[i].tbScore : v;
 
+      if (binary)
+      {
+          bool mate = abs(v) >= VALUE_MATE_IN_MAX_PLY;
+          uint8_t flags =  (!tb && i == pvIdx && v >= beta)  * 1
+                         + (!tb && i == pvIdx && v <= alpha) * 2
+                         + mate * 4;
+          string payload;
+
+          put(payload, uint16_t(i + 1));
+          put(payload, uint8_t(d));
+          put(payload, uint8_t(rootMoves[i].selDepth));
+          put(payload, flags);
+          put(payload, int32_t(mate ? (v > 0 ? VALUE_MATE - v + 1 : -VALUE_MATE - v) / 2
+                                    : v * 100 / PawnValueEg));
+          put(payload, uint64_t(nodesSearched));
+          put(payload, uint64_t(nodesSearched * 1000 / elapsed));
+          put(payload, uint16_t(elapsed > 1000 ? engine.tt.hashfull() : 0));
+          put(payload, uint64_t(tbHits));
+          put(payload, uint32_t(elapsed));
+          put(payload, uint16_t(rootMoves[i].pv.size()));
+
+          for (Move m : rootMoves[i].pv)
+              put(payload, uint16_t(m));
+
+          frames += (frames.empty() ? "" : "\n") + frame(FRAME_INFO, payload);
+          continue;
+      }
+
       if (ss.rdbuf()->in_avail()) // Not at first line
           ss << "\n";
 
@@ -1869,7 +2067,7 @@ string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
          << " multipv "  << i + 1
          << " score "    << UCI::value(v);
 
-      if (Options["UCI_ShowWDL"])
+      if (engine.options["UCI_ShowWDL"])
           ss << UCI::wdl(v, pos.game_ply());
 
       if (!tb && i == pvIdx)
@@ -1879,7 +2077,7 @@ string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
          << " nps "      << nodesSearched * 1000 / elapsed;
 
       if (elapsed > 1000) // Earlier makes little sense
-          ss << " hashfull " << TT.hashfull();
+          ss << " hashfull " << engine.tt.hashfull();
 
       ss << " tbhits "   << tbHits
          << " time "     << elapsed
@@ -1889,7 +2087,7 @@ string UCI::pv(const Position& pos, Depth depth, Value alpha, Value beta) {
           ss << " " << UCI::move(m, pos.is_chess960());
   }
 
-  return ss.str();
+  return binary ? frames : ss.str();
 }
 
 
@@ -1911,7 +2109,7 @@ bool RootMove::extract_ponder_from_tt(Position& pos) {
         return false;
 
     pos.do_move(pv[0], st);
-    TTEntry* tte = TT.probe(pos.key(), ttHit);
+    TTEntry* tte = pos.this_thread()->engine.tt.probe(pos.key(), ttHit);
 
     if (ttHit)
     {
@@ -1924,36 +2122,51 @@ bool RootMove::extract_ponder_from_tt(Position& pos) {
     return pv.size() > 1;
 }
 
-void Tablebases::rank_root_moves(Position& pos, Search::RootMoves& rootMoves) {
+/// Tablebases::search_config() returns the tablebase parameters of the options,
+/// for a search whose root moves are not ranked with the tablebases.
 
-    RootInTB = false;
-    UseRule50 = bool(Options["Syzygy50MoveRule"]);
-    ProbeDepth = int(Options["SyzygyProbeDepth"]);
-    Cardinality = int(Options["SyzygyProbeLimit"]);
-    bool dtz_available = true;
+Tablebases::Config Tablebases::search_config(UCI::OptionsMap& options) {
+
+    Config config;
+    config.useRule50 = bool(options["Syzygy50MoveRule"]);
+    config.probeDepth = int(options["SyzygyProbeDepth"]);
+    config.cardinality = int(options["SyzygyProbeLimit"]);
 
     // Tables with fewer pieces than SyzygyProbeLimit are searched with
     // ProbeDepth == DEPTH_ZERO
-    if (Cardinality > MaxCardinality)
+    if (config.cardinality > MaxCardinality)
     {
-        Cardinality = MaxCardinality;
-        ProbeDepth = 0;
+        config.cardinality = MaxCardinality;
+        config.probeDepth = 0;
     }
 
-    if (Cardinality >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING))
+    return config;
+}
+
+/// Tablebases::rank_root_moves() ranks the root moves with the tablebases, when
+/// the root position is in them, and returns the tablebase parameters to be used
+/// by the search.
+
+Tablebases::Config Tablebases::rank_root_moves(Position& pos, Search::RootMoves& rootMoves,
+                                               UCI::OptionsMap& options) {
+
+    Config config = search_config(options);
+    bool dtz_available = true;
+
+    if (config.cardinality >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING))
     {
         // Rank moves using DTZ tables
-        RootInTB = root_probe(pos, rootMoves);
+        config.rootInTB = root_probe(pos, rootMoves, config.useRule50);
 
-        if (!RootInTB)
+        if (!config.rootInTB)
         {
             // DTZ tables are missing; try to rank moves using WDL tables
             dtz_available = false;
-            RootInTB = root_probe_wdl(pos, rootMoves);
+            config.rootInTB = root_probe_wdl(pos, rootMoves, config.useRule50);
         }
     }
 
-    if (RootInTB)
+    if (config.rootInTB)
     {
         // Sort moves according to TB rank
         std::stable_sort(rootMoves.begin(), rootMoves.end(),
@@ -1961,7 +2174,7 @@ void Tablebases::rank_root_moves(Position& pos, Search::RootMoves& rootMoves) {
 
         // Probe during search only if DTZ is not available and we are winning
         if (dtz_available || rootMoves[0].tbScore <= VALUE_DRAW)
-            Cardinality = 0;
+            config.cardinality = 0;
     }
     else
     {
@@ -1969,6 +2182,8 @@ void Tablebases::rank_root_moves(Position& pos, Search::RootMoves& rootMoves) {
         for (auto& m : rootMoves)
             m.tbRank = 0;
     }
+
+    return config;
 }
 
 } // namespace Stockfish
@@ -28,6 +28,7 @@
 namespace Stockfish {
 
 class Position;
+struct ThreadPool;
 
 namespace Search {
 
@@ -104,10 +105,8 @@ struct LimitsType {
   int64_t nodes;
 };
 
-extern LimitsType Limits;
-
-void init();
-void clear();
+void init(ThreadPool& threads);
+Value leaf_search(Position& pos, Depth depth);
 
 } // namespace Search
 
@@ -0,0 +1,442 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "engine.h"
+#include "evaluate.h"
+#include "misc.h"
+#include "movegen.h"
+#include "selfplay.h"
+#include "uci.h"
+
+using namespace std;
+
+namespace Stockfish {
+
+extern vector<string> setup_positions(Engine&, const string&, vector<bool>&);
+
+namespace Selfplay {
+
+namespace {
+
+  // Adjudication: a game is a draw after MaxPlies plies, or when the score has
+  // stayed within DrawScore for DrawPlies plies past DrawMinPly. It is won when
+  // both sides agree on a score of at least ResignScore for ResignPlies plies.
+  constexpr size_t MaxPlies    = 400;
+  constexpr size_t DrawMinPly  = 80;
+  constexpr int    DrawPlies   = 8;
+  constexpr int    ResignPlies = 4;
+  constexpr Value  DrawScore   = Value(PawnValueEg / 10);
+  constexpr Value  ResignScore = Value(10 * PawnValueEg);
+
+  // pgn() returns the PGN record of a game, the players are called by name
+  string pgn(const Game& game, size_t round, const string& white, const string& black, Engine& engine) {
+
+    const char* results[] = { "0-1", "1/2-1/2", "1-0" };
+    const string result = results[game.result + 1];
+    ostringstream ss;
+
+    ss << "[Event \"selfplay\"]\n"
+       << "[Site \"?\"]\n"
+       << "[Round \"" << round << "\"]\n"
+       << "[White \"" << white << "\"]\n"
+       << "[Black \"" << black << "\"]\n"
+       << "[Result \"" << result << "\"]\n"
+       << "[FEN \"" << game.fen << "\"]\n"
+       << "[SetUp \"1\"]\n";
+
+    if (game.chess960)
+        ss << "[Variant \"Chess960\"]\n";
+
+    ss << "[Termination \"" << game.termination << "\"]\n\n";
+
+    Position pos;
+    StateListPtr states(new std::deque<StateInfo>(1));
+    pos.set(game.fen, game.chess960, &states->back(), engine.threads.main());
+
+    string line;
+    for (size_t i = 0; i < game.moves.size(); ++i)
+    {
+        Move m = game.moves[i];
+        string token;
+        if (pos.side_to_move() == WHITE || i == 0)
+            token = to_string(pos.game_ply() / 2 + 1) + (pos.side_to_move() == WHITE ? ". " : "... ");
+
+        token += san(pos, m);
+
+        if (line.size() + token.size() >= 80)
+        {
+            ss << line << "\n";
+            line.clear();
+        }
+        line += (line.empty() ? "" : " ") + token;
+
+        states->emplace_back();
+        pos.do_move(m, states->back());
+    }
+
+    ss << line << (line.empty() ? "" : " ") << result << "\n\n";
+
+    return ss.str();
+  }
+
+} // namespace
+
+
+/// san() converts a legal move to the standard algebraic notation of PGN
+
+string san(Position& pos, Move m) {
+
+  Square from = from_sq(m), to = to_sq(m);
+  PieceType pt = type_of(pos.moved_piece(m));
+  string s;
+
+  if (type_of(m) == CASTLING)
+      s = to > from ? "O-O" : "O-O-O";
+
+  else if (pt == PAWN)
+  {
+      if (pos.capture(m))
+          s = string(1, char('a' + file_of(from))) + 'x';
+
+      s += UCI::square(to);
+
+      if (type_of(m) == PROMOTION)
+          s += string("=") + " PNBRQK"[promotion_type(m)];
+  }
+  else
+  {
+      s = " PNBRQK"[pt];
+
+      // Disambiguate with the file, the rank, or both
+      bool ambiguous = false, sameFile = false, sameRank = false;
+      for (const auto& other : MoveList<LEGAL>(pos))
+          if (   to_sq(other) == to
+              && from_sq(other) != from
+              && type_of(pos.moved_piece(other)) == pt)
+          {
+              ambiguous = true;
+              sameFile |= file_of(from_sq(other)) == file_of(from);
+              sameRank |= rank_of(from_sq(other)) == rank_of(from);
+          }
+
+      if (ambiguous)
+      {
+          string sq = UCI::square(from);
+          s += !sameFile ? sq.substr(0, 1) : !sameRank ? sq.substr(1, 1) : sq;
+      }
+
+      if (pos.capture(m))
+          s += 'x';
+
+      s += UCI::square(to);
+  }
+
+  if (pos.gives_check(m))
+  {
+      StateInfo st;
+      pos.do_move(m, st, true);
+      s += MoveList<LEGAL>(pos).size() ? '+' : '#';
+      pos.undo_move(m);
+  }
+
+  return s;
+}
+
+
+/// new_player() creates an engine with one thread and the given hash size to
+/// play games. It copies the other options of the given engine, without
+/// calling their on_change(), so that the networks are shared as they are.
+
+std::unique_ptr<Engine> new_player(Engine& engine, size_t hashMB) {
+
+  std::unique_ptr<Engine> player(new Engine([](const string&) {}));
+
+  player->options["Hash"] = to_string(hashMB);
+
+  for (auto& it : player->options)
+      if (   it.first != "Threads"
+          && it.first != "Hash"
+          && engine.options.count(it.first))
+          it.second.copy_value(engine.options[it.first]);
+
+  return player;
+}
+
+
+/// play() plays a game from the start position of the given game record,
+/// between the engines of the two colors, each move being searched with the
+/// limits of goArgs. Both engines are cleared first and the moves, scores and
+/// result are stored in the game record.
+
+void play(Engine* players[COLOR_NB], const string& goArgs, Game& game) {
+
+  Position pos;
+  StateListPtr states(new std::deque<StateInfo>(1));
+  pos.set(game.fen, game.chess960, &states->back(), players[WHITE]->threads.main());
+
+  for (Color c : { WHITE, BLACK })
+  {
+      players[c]->options["UCI_Chess960"] = string(game.chess960 ? "true" : "false");
+      players[c]->clear();
+  }
+
+  string moves;
+  int drawPlies = 0, resignPlies = 0, lastWinner = 0;
+
+  game.moves.clear();
+  game.scores.clear();
+
+  while (true)
+  {
+      if (!MoveList<LEGAL>(pos).size())
+      {
+          game.result = pos.checkers() ? (pos.side_to_move() == WHITE ? -1 : 1) : 0;
+          game.termination = pos.checkers() ? "checkmate" : "stalemate";
+          return;
+      }
+
+      if (pos.is_draw(0))
+      {
+          game.result = 0;
+          game.termination = pos.rule50_count() > 99 ? "fifty-move rule" : "threefold repetition";
+          return;
+      }
+
+      if (!pos.count<PAWN>() && pos.non_pawn_material() <= BishopValueMg)
+      {
+          game.result = 0;
+          game.termination = "insufficient material";
+          return;
+      }
+
+      if (game.moves.size() >= MaxPlies)
+      {
+          game.result = 0;
+          game.termination = "adjudication";
+          return;
+      }
+
+      Color us = pos.side_to_move();
+      Engine* player = players[us];
+
+      istringstream position("fen " + game.fen + " moves" + moves);
+      istringstream go(goArgs);
+      player->position(position);
+      player->go(go);
+      player->wait_for_search_finished();
+
+      Move m = player->threads.main()->bestMove;
+      Value v = player->threads.main()->bestPreviousScore;
+
+      game.moves.push_back(m);
+      game.scores.push_back(v);
+      moves += " " + UCI::move(m, game.chess960);
+
+      states->emplace_back();
+      pos.do_move(m, states->back());
+
+      // Adjudicate on the scores of the last plies
+      int winner = abs(v) < ResignScore ? 0 : (v > 0) == (us == WHITE) ? 1 : -1;
+      resignPlies = winner && winner == lastWinner ? resignPlies + 1 : !!winner;
+      lastWinner = winner;
+
+      drawPlies = game.moves.size() >= DrawMinPly && abs(v) <= DrawScore ? drawPlies + 1 : 0;
+
+      if (resignPlies >= ResignPlies || drawPlies >= DrawPlies)
+      {
+          game.result = resignPlies >= ResignPlies ? winner : 0;
+          game.termination = "adjudication";
+          return;
+      }
+  }
+}
+
+
+/// match() is called when the engine receives the "selfplay" command. It plays
+/// games between two engines A and B, as many at the same time as there are
+/// threads, each game with its own pair of one-threaded engines sharing the
+/// hash size. Each opening of the book is played twice, once with each color.
+/// B differs from A by the options that follow the other arguments:
+/// selfplay [bookFile] [depth|nodes|movetime] [limit] [games] [pgnFile] [name <id> value <x>]...
+
+void match(Engine& engine, istream& args) {
+
+  string token;
+  string bookFile  = (args >> token) ? token : "default";
+  string limitType = (args >> token) ? token : "nodes";
+  string limit     = (args >> token) ? token : "10000";
+  string gameArg   = (args >> token) ? token : "100";
+  string pgnFile   = (args >> token) ? token : "selfplay.pgn";
+
+  if (limitType != "depth" && limitType != "nodes" && limitType != "movetime")
+  {
+      sync_cout << "Unknown limit type " << limitType << sync_endl;
+      return;
+  }
+
+  int64_t number;
+  if (!parse_number(limit, number) || number < 1 || number > INT_MAX)
+  {
+      sync_cout << "Invalid limit " << limit << sync_endl;
+      return;
+  }
+
+  if (!parse_number(gameArg, number) || number < 1)
+  {
+      sync_cout << "Invalid number of games " << gameArg << sync_endl;
+      return;
+  }
+
+  size_t games = size_t(number);
+
+  // The options of B, with the syntax of the "setoption" command
+  vector<pair<string, string>> optionsB;
+  bool isValue = false;
+  while (args >> token)
+      if (token == "name" || token == "value")
+      {
+          if (token == "name")
+              optionsB.emplace_back();
+          isValue = token == "value";
+      }
+      else if (!optionsB.empty())
+      {
+          string& s = isValue ? optionsB.back().second : optionsB.back().first;
+          s += (s.empty() ? "" : " ") + token;
+      }
+
+  for (const auto& [name, value] : optionsB)
+      if (!engine.options.count(name))
+      {
+          sync_cout << "No such option: " << name << sync_endl;
+          return;
+      }
+
+  vector<bool> chess960;
+  vector<string> fens = setup_positions(engine, bookFile, chess960);
+
+  engine.hot_swap();
+  Eval::NNUE::verify(engine);
+
+  size_t workers = std::min(engine.threads.size(), games);
+  size_t hashMB = std::max(size_t(engine.options["Hash"]) / (2 * workers), size_t(1));
+
+  // The engines are created here, as the UCI options may not be set concurrently
+  vector<std::unique_ptr<Engine>> players;
+  for (size_t i = 0; i < 2 * workers; ++i)
+      players.push_back(new_player(engine, hashMB));
+
+  // The options that act on the whole process would be changed for A as well,
+  // and the parameters of tune.cpp, which are global variables, are not options
+  // of the players.
+  for (const auto& [name, value] : optionsB)
+      if (Engine::shared_option(name) || !players[1]->options.count(name))
+      {
+          sync_cout << "info string ERROR: " << name << " is shared by A and B"
+                       " and cannot be set for B only" << sync_endl;
+          return;
+      }
+
+  for (size_t i = 1; i < players.size(); i += 2)
+      for (const auto& [name, value] : optionsB)
+          players[i]->options[name] = value;
+
+  ofstream pgnStream(pgnFile, ios::app);
+  std::mutex mutex;
+  std::atomic<size_t> next(0);
+  size_t wins = 0, draws = 0, losses = 0, done = 0;
+  TimePoint elapsed = now();
+
+  auto worker = [&](size_t idx) {
+
+      for (size_t i; (i = next++) < games; )
+      {
+          Game game;
+          game.fen = fens[(i / 2) % fens.size()];
+          game.chess960 = chess960[(i / 2) % fens.size()];
+
+          // A plays White in the even games and Black in the odd ones
+          Engine* a = players[2 * idx].get();
+          Engine* b = players[2 * idx + 1].get();
+          Engine* colors[COLOR_NB] = { i % 2 ? b : a, i % 2 ? a : b };
+
+          play(colors, limitType + " " + limit, game);
+
+          int resultA = i % 2 ? -game.result : game.result;
+          std::lock_guard<std::mutex> lk(mutex);
+
+          wins += resultA > 0, draws += resultA == 0, losses += resultA < 0, ++done;
+
+          pgnStream << pgn(game, i + 1, i % 2 ? "B" : "A", i % 2 ? "A" : "B", *colors[WHITE]);
+
+          sync_cout << "game " << i + 1 << '/' << games
+                    << (i % 2 ? " B-A " : " A-B ")
+                    << (game.result > 0 ? "1-0" : game.result < 0 ? "0-1" : "1/2-1/2")
+                    << " (" << game.termination << ") plies " << game.moves.size()
+                    << " score of A " << wins << '-' << losses << '-' << draws << sync_endl;
+      }
+  };
+
+  vector<std::thread> threads;
+  for (size_t idx = 0; idx < workers; ++idx)
+      threads.emplace_back(worker, idx);
+
+  for (auto& th : threads)
+      th.join();
+
+  elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+
+  // Elo difference with its 95% confidence interval and the likelihood of
+  // superiority, from the trinomial distribution of the results of A.
+  double n = std::max(done, size_t(1));
+  double score = (wins + draws / 2.0) / n;
+  double variance = (  wins   * (1.0 - score) * (1.0 - score)
+                     + draws  * (0.5 - score) * (0.5 - score)
+                     + losses * score * score) / n;
+  double margin = 1.96 * std::sqrt(variance / n);
+
+  auto elo = [](double s) {
+      s = std::clamp(s, 1e-6, 1 - 1e-6);
+      return -400.0 * std::log10(1.0 / s - 1.0);
+  };
+
+  double los = wins + losses ? 0.5 * (1 + std::erf((double(wins) - losses) / std::sqrt(2.0 * (wins + losses)))) : 0.5;
+
+  cerr << "\n==========================="
+       << "\nGames played       : " << done
+       << "\nScore of A vs B    : " << wins << " - " << losses << " - " << draws << " [" << score << "]"
+       << "\nElo difference     : " << elo(score)
+       << " +/- " << (elo(score + margin) - elo(score - margin)) / 2
+       << "\nLOS                : " << 100 * los << " %"
+       << "\nTotal time (ms)    : " << elapsed
+       << "\nGames/hour         : " << 3600000.0 * done / elapsed << endl;
+}
+
+} // namespace Selfplay
+
+} // namespace Stockfish
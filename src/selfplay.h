@@ -0,0 +1,58 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SELFPLAY_H_INCLUDED
+#define SELFPLAY_H_INCLUDED
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace Stockfish {
+
+class Engine;
+class Position;
+
+namespace Selfplay {
+
+/// Game keeps the record of a game played by play(): the start position, the
+/// moves with the score reported for each of them, from the point of view of
+/// the side that played it, and the result from the point of view of White.
+
+struct Game {
+  std::string fen;
+  bool chess960 = false;
+  std::vector<Move> moves;
+  std::vector<Value> scores;
+  int result = 0; // 1, 0 or -1 for a white win, a draw or a black win
+  std::string termination;
+};
+
+std::string san(Position& pos, Move m);
+std::unique_ptr<Engine> new_player(Engine& engine, size_t hashMB);
+void play(Engine* players[COLOR_NB], const std::string& goArgs, Game& game);
+void match(Engine& engine, std::istream& args);
+
+} // namespace Selfplay
+
+} // namespace Stockfish
+
+#endif // #ifndef SELFPLAY_H_INCLUDED
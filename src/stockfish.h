@@ -0,0 +1,68 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2022 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STOCKFISH_H_INCLUDED
+#define STOCKFISH_H_INCLUDED
+
+/// The C interface of libstockfish, to embed any number of engines in one
+/// process. Each engine has its own options, thread pool and transposition
+/// table, and reports the lines a UCI engine would print ("info ...",
+/// "bestmove ...") to its output callback, from the search threads. The
+/// string arguments are those of the corresponding UCI commands, for example
+/// sf_engine_position(e, "startpos moves e2e4") or sf_engine_go(e, "depth 10").
+///
+/// The NNUE networks and the tablebase files are loaded once for the whole
+/// process, so the options "EvalFile", "EvalFileSmall", "Use NNUE", "NNUE Eager
+/// Update", "NNUE Prefetch", "NNUE Hot Swap" and "SyzygyPath" can only be set
+/// while there is a single engine. A new engine takes their values from the
+/// existing ones. The engines should be created and deleted from a single
+/// thread, after which each one may be driven by its own thread.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct sf_engine sf_engine;
+typedef void (*sf_output_fn)(const char* line, void* userdata);
+
+/// sf_init() initializes the tables shared by all the engines. It is called
+/// by sf_engine_new() if needed, argv0 is used to find the network files.
+void sf_init(const char* argv0);
+
+/// sf_engine_new() creates an engine with the default options, set up at the
+/// initial position. Without a callback, the output goes to stdout.
+sf_engine* sf_engine_new(sf_output_fn fn, void* userdata);
+void sf_engine_delete(sf_engine* e);
+
+/// sf_engine_setoption() waits for the current search, then sets the option.
+/// It returns -1 if there is no such option, -2 if it is one of the options
+/// above while there are several engines, else 0.
+int sf_engine_setoption(sf_engine* e, const char* name, const char* value);
+
+void sf_engine_position(sf_engine* e, const char* args);
+void sf_engine_go(sf_engine* e, const char* args);      // Returns immediately
+void sf_engine_stop(sf_engine* e);
+void sf_engine_ponderhit(sf_engine* e);
+void sf_engine_wait(sf_engine* e);                       // Until "bestmove" is sent
+void sf_engine_newgame(sf_engine* e);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // #ifndef STOCKFISH_H_INCLUDED
@@ -22,6 +22,7 @@
 #include <ostream>
 
 #include "../search.h"
+#include "../uci.h"
 
 namespace Stockfish::Tablebases {
 
@@ -43,14 +44,24 @@ enum ProbeState {
     ZEROING_BEST_MOVE =  2  // Best move zeroes DTZ (capture or pawn move)
 };
 
+// Tablebase parameters of a search, set up at the root by rank_root_moves(),
+// or by search_config() when the root moves are not ranked
+struct Config {
+    int cardinality = 0;
+    bool rootInTB = false;
+    bool useRule50 = true;
+    Depth probeDepth = 0;
+};
+
 extern int MaxCardinality;
 
 void init(const std::string& paths);
 WDLScore probe_wdl(Position& pos, ProbeState* result);
 int probe_dtz(Position& pos, ProbeState* result);
-bool root_probe(Position& pos, Search::RootMoves& rootMoves);
-bool root_probe_wdl(Position& pos, Search::RootMoves& rootMoves);
-void rank_root_moves(Position& pos, Search::RootMoves& rootMoves);
+bool root_probe(Position& pos, Search::RootMoves& rootMoves, bool rule50);
+bool root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50);
+Config search_config(UCI::OptionsMap& options);
+Config rank_root_moves(Position& pos, Search::RootMoves& rootMoves, UCI::OptionsMap& options);
 
 inline std::ostream& operator<<(std::ostream& os, const WDLScore v) {
 
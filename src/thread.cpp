@@ -19,6 +19,7 @@
 #include <cassert>
 
 #include <algorithm> // For std::count
+#include "engine.h"
 #include "movegen.h"
 #include "search.h"
 #include "thread.h"
@@ -28,13 +29,10 @@
 
 namespace Stockfish {
 
-ThreadPool Threads; // Global object
-
-
 /// Thread constructor launches the thread and waits until it goes to sleep
 /// in idle_loop(). Note that 'searching' and 'exit' should be already set.
 
-Thread::Thread(size_t n) : idx(n), stdThread(&Thread::idle_loop, this) {
+Thread::Thread(Engine& e, size_t n) : engine(e), idx(n), stdThread(&Thread::idle_loop, this) {
 
   wait_for_search_finished();
 }
@@ -93,17 +91,28 @@ void Thread::wait_for_search_finished() {
 }
 
 
+/// Thread::is_searching() tells if the thread has a search to finish
+
+bool Thread::is_searching() {
+
+  std::lock_guard<std::mutex> lk(mutex);
+  return searching;
+}
+
+
 /// Thread::idle_loop() is where the thread is parked, blocked on the
 /// condition variable, when it has no work to do.
 
 void Thread::idle_loop() {
 
+  systemId = PerfCounters::thread_id();
+
   // If OS already scheduled us on a different group than 0 then don't overwrite
   // the choice, eventually we are one of many one-threaded processes running on
   // some Windows NUMA hardware, for instance in fishtest. To make it simple,
   // just check if running threads are below a threshold, in this case all this
   // NUMA machinery is not needed.
-  if (Options["Threads"] > 8)
+  if (engine.options["Threads"] > 8)
       WinProcGroup::bindThisThread(idx);
 
   while (true)
@@ -118,7 +127,10 @@ void Thread::idle_loop() {
 
       lk.unlock();
 
-      search();
+      if (analysing)
+          analyse();
+      else
+          search();
   }
 }
 
@@ -138,17 +150,17 @@ void ThreadPool::set(size_t requested) {
 
   if (requested > 0)   // create new thread(s)
   {
-      push_back(new MainThread(0));
+      push_back(new MainThread(engine, 0));
 
       while (size() < requested)
-          push_back(new Thread(size()));
+          push_back(new Thread(engine, size()));
       clear();
 
       // Reallocate the hash with the new threadpool size
-      TT.resize(size_t(Options["Hash"]));
+      engine.tt.resize(size_t(engine.options["Hash"]), *this);
 
       // Init thread number dependent search params.
-      Search::init();
+      Search::init(*this);
   }
 }
 
@@ -167,6 +179,45 @@ void ThreadPool::clear() {
 }
 
 
+/// ThreadPool::analyse() searches the given positions with the same limits, one
+/// position per thread at a time. Each thread takes the next position as soon as
+/// it is done with the previous one, keeping its own root and histories, while
+/// the TT is shared. The results are printed as they come, and the function
+/// returns when all the positions have been searched.
+
+void ThreadPool::analyse(const std::vector<std::string>& fens, const std::vector<bool>& chess960,
+                         const Search::LimitsType& limits) {
+
+  main()->wait_for_search_finished();
+
+  stop = false;
+  increaseDepth = true;
+  engine.limits = limits;
+  engine.tt.new_search();
+
+  // The positions share the tablebase parameters, without root ranking
+  engine.tbConfig = Tablebases::search_config(engine.options);
+
+  analysisFens = fens;
+  analysisNext = analysisDone = 0;
+  analysisNodes = 0;
+  analysisChess960 = chess960;
+  analysisStart = now();
+
+  for (Thread* th : *this)
+  {
+      th->analysing = true;
+      th->start_searching();
+  }
+
+  for (Thread* th : *this)
+  {
+      th->wait_for_search_finished();
+      th->analysing = false;
+  }
+}
+
+
 /// ThreadPool::start_thinking() wakes up main thread waiting in idle_loop() and
 /// returns immediately. Main thread will wake up other threads and start the search.
 
@@ -178,7 +229,7 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
   main()->stopOnPonderhit = stop = false;
   increaseDepth = true;
   main()->ponder = ponderMode;
-  Search::Limits = limits;
+  engine.limits = limits;
   Search::RootMoves rootMoves;
 
   for (const auto& m : MoveList<LEGAL>(pos))
@@ -186,8 +237,8 @@ void ThreadPool::start_thinking(Position& pos, StateListPtr& states,
           || std::count(limits.searchmoves.begin(), limits.searchmoves.end(), m))
           rootMoves.emplace_back(m);
 
-  if (!rootMoves.empty())
-      Tablebases::rank_root_moves(pos, rootMoves);
+  engine.tbConfig = rootMoves.empty() ? Tablebases::Config()
+                                      : Tablebases::rank_root_moves(pos, rootMoves, engine.options);
 
   // After ownership transfer 'states' becomes empty, so if we stop the search
   // and call 'go' again without setting a new position states.get() == NULL.
@@ -264,4 +315,12 @@ void ThreadPool::wait_for_search_finished() const {
             th->wait_for_search_finished();
 }
 
+
+/// ThreadPool::searching() tells if any thread of the pool is searching
+
+bool ThreadPool::searching() const {
+
+  return std::any_of(begin(), end(), [](Thread* th) { return th->is_searching(); });
+}
+
 } // namespace Stockfish
@@ -34,13 +34,21 @@
 
 namespace Stockfish {
 
+class Engine;
+
 /// Thread class keeps together all the thread-related stuff. We use
 /// per-thread pawn and material hash tables so that once we get a
 /// pointer to an entry its life time is unlimited and we don't have
-/// to care about someone changing the entry under our feet.
+/// to care about someone changing the entry under our feet. Each thread
+/// belongs to the thread pool of an engine, which holds the shared state
+/// of the search.
 
 class Thread {
 
+public:
+  Engine& engine; // Set before starting std::thread
+
+private:
   std::mutex mutex;
   std::condition_variable cv;
   size_t idx;
@@ -48,14 +56,18 @@ class Thread {
   NativeThread stdThread;
 
 public:
-  explicit Thread(size_t);
+  Thread(Engine&, size_t);
   virtual ~Thread();
   virtual void search();
   void clear();
   void idle_loop();
   void start_searching();
   void wait_for_search_finished();
+  bool is_searching();
+  void analyse();
+  void check_analysis_limits();
   size_t id() const { return idx; }
+  int systemId; // Set in idle_loop(), see PerfCounters
 
   Pawns::Table pawnsTable;
   Material::Table materialTable;
@@ -76,6 +88,12 @@ public:
   CapturePieceToHistory captureHistory;
   ContinuationHistory continuationHistory[2][2];
   Score trend;
+
+  // Batch analysis, where each thread searches its own positions with its own
+  // limits, see ThreadPool::analyse()
+  bool analysing = false, analysisStop = false;
+  TimePoint analysisStart;
+  int analysisCalls;
 };
 
 
@@ -91,6 +109,7 @@ struct MainThread : public Thread {
   double previousTimeReduction;
   Value bestPreviousScore;
   Value bestPreviousAverageScore;
+  Move bestMove; // Reported by the last search
   Value iterValue[4];
   int callsCnt;
   bool stopOnPonderhit;
@@ -104,6 +123,8 @@ struct MainThread : public Thread {
 
 struct ThreadPool : public std::vector<Thread*> {
 
+  explicit ThreadPool(Engine& e) : engine(e) {}
+
   void start_thinking(Position&, StateListPtr&, const Search::LimitsType&, bool = false);
   void clear();
   void set(size_t);
@@ -114,10 +135,22 @@ struct ThreadPool : public std::vector<Thread*> {
   Thread* get_best_thread() const;
   void start_searching();
   void wait_for_search_finished() const;
+  bool searching() const;
+  void analyse(const std::vector<std::string>& fens, const std::vector<bool>& chess960,
+               const Search::LimitsType& limits);
 
   std::atomic_bool stop, increaseDepth;
+  int reductions[MAX_MOVES]; // [depth or moveNumber], see Search::init()
+
+  // Positions of the batch analysis, taken in turn by the threads
+  std::vector<std::string> analysisFens;
+  std::atomic<size_t> analysisNext, analysisDone;
+  std::atomic<uint64_t> analysisNodes;
+  std::vector<bool> analysisChess960;
+  TimePoint analysisStart;
 
 private:
+  Engine& engine;
   StateListPtr setupStates;
 
   uint64_t accumulate(std::atomic<uint64_t> Thread::* member) const {
@@ -129,8 +162,6 @@ private:
   }
 };
 
-extern ThreadPool Threads;
-
 } // namespace Stockfish
 
 #endif // #ifndef THREAD_H_INCLUDED
@@ -22,30 +22,33 @@
 #include "misc.h"
 #include "search.h"
 #include "thread.h"
+#include "uci.h"
 
 namespace Stockfish {
 
 /// The TimeManagement class computes the optimal time to think depending on
-/// the maximum available time, the game move number and other parameters.
+/// the maximum available time, the game move number and other parameters. It
+/// works on the search limits and the thread pool of its engine.
 
 class TimeManagement {
 public:
-  void init(Search::LimitsType& limits, Color us, int ply);
+  TimeManagement(Search::LimitsType& l, const ThreadPool& tp) : limits(l), threads(tp) {}
+  void init(Color us, int ply, UCI::OptionsMap& options);
   TimePoint optimum() const { return optimumTime; }
   TimePoint maximum() const { return maximumTime; }
-  TimePoint elapsed() const { return Search::Limits.npmsec ?
-                                     TimePoint(Threads.nodes_searched()) : now() - startTime; }
+  TimePoint elapsed() const { return limits.npmsec ?
+                                     TimePoint(threads.nodes_searched()) : now() - startTime; }
 
-  int64_t availableNodes; // When in 'nodes as time' mode
+  int64_t availableNodes = 0; // When in 'nodes as time' mode
 
 private:
-  TimePoint startTime;
+  Search::LimitsType& limits;
+  const ThreadPool& threads;
+  TimePoint startTime = 0;
   TimePoint optimumTime;
   TimePoint maximumTime;
 };
 
-extern TimeManagement Time;
-
 } // namespace Stockfish
 
 #endif // #ifndef TIMEMAN_H_INCLUDED
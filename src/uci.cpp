@@ -16,16 +16,24 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include "datagen.h"
+#include "engine.h"
 #include "evaluate.h"
 #include "movegen.h"
 #include "position.h"
 #include "search.h"
+#include "selfplay.h"
 #include "thread.h"
 #include "timeman.h"
 #include "tt.h"
@@ -37,164 +45,490 @@ using namespace std;
 namespace Stockfish {
 
 extern vector<string> setup_bench(const Position&, istream&);
+extern vector<string> setup_positions(Engine&, const string&, vector<bool>&);
 
 namespace {
 
-  // FEN string for the initial position in standard chess
-  const char* StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+  // new_game() is called when the engine receives the "ucinewgame" command. It
+  // clears the search state and frees the mapped tablebase files.
 
+  void new_game(Engine& engine) {
 
-  // position() is called when the engine receives the "position" UCI command.
-  // It sets up the position that is described in the given FEN string ("fen") or
-  // the initial position ("startpos") and then makes the moves given in the following
-  // move list ("moves").
+    engine.clear();
+    Tablebases::init(engine.options["SyzygyPath"]); // Free mapped files
+  }
+
+
+  // trace_eval() prints the evaluation of the current position, consistent with
+  // the UCI options set so far.
+
+  void trace_eval(Engine& engine) {
+
+    StateListPtr states(new std::deque<StateInfo>(1));
+    Position p;
+    p.set(engine.pos.fen(), engine.options["UCI_Chess960"], &states->back(), engine.threads.main());
 
-  void position(Position& pos, istringstream& is, StateListPtr& states) {
+    engine.hot_swap();
+    Eval::NNUE::verify(engine);
+
+    sync_cout << "\n" << Eval::trace(p) << sync_endl;
+  }
+
+
+  // bench_run() runs the commands set up by setup_bench() for one TT size and
+  // one number of threads. The summary goes to stderr, either as text or, if
+  // json is set, as one JSON object with the results of each position.
+
+  void bench_run(Engine& engine, istream& args, bool json, bool perf) {
+
+    string token;
+    uint64_t num, nodes = 0, cnt = 1;
+    ostringstream positions;
+    PerfCounters counters;
 
-    Move m;
-    string token, fen;
+    vector<string> list = setup_bench(engine.pos, args);
+    num = count_if(list.begin(), list.end(), [](string s) { return s.find("go ") == 0 || s.find("eval") == 0; });
 
-    is >> token;
+    TimePoint elapsed = now();
 
-    if (token == "startpos")
+    for (const auto& cmd : list)
     {
-        fen = StartFEN;
-        is >> token; // Consume the "moves" token, if any
+        istringstream is(cmd);
+        is >> skipws >> token;
+
+        if (token == "go" || token == "eval")
+        {
+            if (!json)
+                cerr << "\nPosition: " << cnt << '/' << num << " (" << engine.pos.fen() << ")" << endl;
+            cnt++;
+
+            if (token == "go")
+            {
+               if (perf)
+               {
+                   vector<int> threadIds;
+                   for (Thread* th : engine.threads)
+                       threadIds.push_back(th->systemId);
+                   counters.start(threadIds);
+               }
+
+               TimePoint start = now();
+               engine.go(is);
+               engine.wait_for_search_finished();
+               TimePoint time = now() - start + 1;
+               counters.stop();
+               uint64_t n = engine.threads.nodes_searched();
+               nodes += n;
+
+               if (json)
+                   positions << (positions.tellp() ? "," : "")
+                             << "\n        { \"fen\": \"" << engine.pos.fen()
+                             << "\", \"eval\": \"" << (Eval::useNNUE ? "NNUE" : "classical")
+                             << "\", \"depth\": " << engine.threads.get_best_thread()->completedDepth
+                             << ", \"nodes\": " << n
+                             << ", \"time_ms\": " << time
+                             << ", \"nps\": " << 1000 * n / time
+                             << ", \"hashfull\": " << engine.tt.hashfull() << " }";
+            }
+            else
+               trace_eval(engine);
+        }
+        else if (token == "setoption")  engine.setoption(is);
+        else if (token == "position")   engine.position(is);
+        else if (token == "ucinewgame") { new_game(engine); elapsed = now(); } // new_game() may take a while
     }
-    else if (token == "fen")
-        while (is >> token && token != "moves")
-            fen += token + " ";
-    else
-        return;
 
-    states = StateListPtr(new std::deque<StateInfo>(1)); // Drop the old state and create a new one
-    pos.set(fen, Options["UCI_Chess960"], &states->back(), Threads.main());
+    elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+
+    dbg_print();
 
-    // Parse the move list, if any
-    while (is >> token && (m = UCI::to_move(pos, token)) != MOVE_NONE)
+    if (json)
     {
-        states->emplace_back();
-        pos.do_move(m, states->back());
+        cerr << "\n    {"
+             << "\n      \"threads\": " << size_t(engine.options["Threads"])
+             << ",\n      \"hash\": " << size_t(engine.options["Hash"])
+             << ",\n      \"positions\": [" << positions.str() << "\n      ]"
+             << ",\n      \"time_ms\": " << elapsed
+             << ",\n      \"nodes\": " << nodes
+             << ",\n      \"nps\": " << 1000 * nodes / elapsed;
+
+        if (perf)
+            for (int e = 0; e < PerfCounters::EVENT_NB; ++e)
+            {
+                string key = PerfCounters::name(PerfCounters::Event(e));
+                transform(key.begin(), key.end(), key.begin(),
+                          [](char c) { return c == ' ' ? '_' : char(tolower(c)); });
+
+                cerr << ",\n      \"" << key << "\": ";
+                if (counters.available(PerfCounters::Event(e)))
+                    cerr << counters.total(PerfCounters::Event(e));
+                else
+                    cerr << "null";
+            }
+
+        cerr << "\n    }";
+    }
+    else
+    {
+        cerr << "\n==========================="
+             << "\nTotal time (ms) : " << elapsed
+             << "\nNodes searched  : " << nodes
+             << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
+
+        if (perf)
+            for (int e = 0; e < PerfCounters::EVENT_NB; ++e)
+            {
+                PerfCounters::Event ev = PerfCounters::Event(e);
+                ostringstream ss;
+
+                ss << left << setw(16) << PerfCounters::name(ev) << ": ";
+                if (counters.available(ev))
+                    ss << counters.total(ev) << " (" << fixed << setprecision(2)
+                       << double(counters.total(ev)) / std::max(nodes, uint64_t(1))
+                       << " per node)";
+                else
+                    ss << "not available";
+
+                cerr << ss.str() << endl;
+            }
     }
   }
 
-  // trace_eval() prints the evaluation of the current position, consistent with
-  // the UCI options set so far.
+  // bench() is called when the engine receives the "bench" command.
+  // Firstly, a list of UCI commands is set up according to the bench
+  // parameters, then it is run one by one, printing a summary at the end.
+  // The ttSize and threads parameters may be comma-separated lists, to run
+  // the suite for each combination of them. A trailing "json" token turns
+  // the summary into a JSON document with the results of each position, and
+  // a trailing "perf" token adds the hardware event counts of the search
+  // threads, on Linux, to the summary.
 
-  void trace_eval(Position& pos) {
+  void bench(Engine& engine, istream& args) {
 
-    StateListPtr states(new std::deque<StateInfo>(1));
-    Position p;
-    p.set(pos.fen(), Options["UCI_Chess960"], &states->back(), Threads.main());
+    string token;
+    vector<string> params;
+    while (args >> token)
+        params.push_back(token);
 
-    Eval::NNUE::verify();
+    bool json = false, perf = false;
+    while (!params.empty() && (params.back() == "json" || params.back() == "perf"))
+    {
+        (params.back() == "json" ? json : perf) = true;
+        params.pop_back();
+    }
 
-    sync_cout << "\n" << Eval::trace(p) << sync_endl;
-  }
+    auto split = [](const string& list) {
+        vector<string> values;
+        istringstream ss(list);
+        for (string v; getline(ss, v, ','); )
+            values.push_back(v);
+        return values;
+    };
 
+    string rest;
+    for (size_t i = 2; i < params.size(); ++i)
+        rest += " " + params[i];
 
-  // setoption() is called when the engine receives the "setoption" UCI command.
-  // The function updates the UCI option ("name") to the given value ("value").
+    if (json)
+        cerr << "{\n  \"runs\": [";
 
-  void setoption(istringstream& is) {
+    bool first = true;
+    for (const string& ttSize : split(params.size() > 0 ? params[0] : "16"))
+        for (const string& threads : split(params.size() > 1 ? params[1] : "1"))
+        {
+            if (json && !first)
+                cerr << ",";
+            first = false;
 
-    string token, name, value;
+            istringstream is(ttSize + " " + threads + rest);
+            bench_run(engine, is, json, perf);
+        }
 
-    is >> token; // Consume the "name" token
+    if (json)
+        cerr << "\n  ]\n}" << endl;
+  }
 
-    // Read the option name (can contain spaces)
-    while (is >> token && token != "value")
-        name += (name.empty() ? "" : " ") + token;
+  // nnuebench() is called when the engine receives the "nnuebench" command.
+  // It times the building blocks of the NNUE evaluation on the bench positions,
+  // or on the positions of a FEN file: nnuebench [iterations] [fenFile]
 
-    // Read the option value (can contain spaces)
-    while (is >> token)
-        value += (value.empty() ? "" : " ") + token;
+  void nnuebench(Engine& engine, istream& args) {
 
-    if (Options.count(name))
-        Options[name] = value;
-    else
-        sync_cout << "No such option: " << name << sync_endl;
+    string token;
+    int64_t iterations = 1000;
+
+    if ((args >> token) && (!parse_number(token, iterations) || iterations < 1 || iterations > INT_MAX))
+    {
+        sync_cout << "Invalid number of iterations " << token << sync_endl;
+        return;
+    }
+
+    string fenFile = (args >> token) ? token : "default";
+
+    istringstream is("16 1 1 " + fenFile + " depth NNUE");
+    vector<string> fens;
+    for (const auto& cmd : setup_bench(engine.pos, is))
+        if (cmd.find("position fen ") == 0)
+            fens.push_back(cmd.substr(13));
+
+    engine.hot_swap();
+    Eval::NNUE::verify(engine);
+    if (Eval::useNNUE)
+        Eval::NNUE::benchmark(engine.threads.main(), fens, int(iterations));
   }
 
+  // analyse() is called when the engine receives the "analyse" command. It
+  // searches all the positions of a FEN or EPD file with the same limit, one
+  // position per thread, and prints the results as they come:
+  // analyse [fenFile] [depth|nodes|movetime] [limit]
 
-  // go() is called when the engine receives the "go" UCI command. The function
-  // sets the thinking time and other parameters from the input string, then starts
-  // with a search.
+  void analyse(Engine& engine, istream& args) {
 
-  void go(Position& pos, istringstream& is, StateListPtr& states) {
+    string token;
+    string fenFile   = (args >> token) ? token : "default";
+    string limitType = (args >> token) ? token : "depth";
+    int64_t limit    = 13;
+
+    if (limitType != "depth" && limitType != "nodes" && limitType != "movetime")
+    {
+        sync_cout << "Unknown limit type " << limitType << sync_endl;
+        return;
+    }
+
+    if ((args >> token) && (!parse_number(token, limit) || limit < 1 || limit > INT_MAX))
+    {
+        sync_cout << "Invalid limit " << token << sync_endl;
+        return;
+    }
 
     Search::LimitsType limits;
-    string token;
-    bool ponderMode = false;
-
-    limits.startTime = now(); // The search starts as early as possible
-
-    while (is >> token)
-        if (token == "searchmoves") // Needs to be the last command on the line
-            while (is >> token)
-                limits.searchmoves.push_back(UCI::to_move(pos, token));
-
-        else if (token == "wtime")     is >> limits.time[WHITE];
-        else if (token == "btime")     is >> limits.time[BLACK];
-        else if (token == "winc")      is >> limits.inc[WHITE];
-        else if (token == "binc")      is >> limits.inc[BLACK];
-        else if (token == "movestogo") is >> limits.movestogo;
-        else if (token == "depth")     is >> limits.depth;
-        else if (token == "nodes")     is >> limits.nodes;
-        else if (token == "movetime")  is >> limits.movetime;
-        else if (token == "mate")      is >> limits.mate;
-        else if (token == "perft")     is >> limits.perft;
-        else if (token == "infinite")  limits.infinite = 1;
-        else if (token == "ponder")    ponderMode = true;
-
-    Threads.start_thinking(pos, states, limits, ponderMode);
-  }
+    limits.startTime = now();
+    if (limitType == "depth")
+        limits.depth = int(limit);
+    else if (limitType == "nodes")
+        limits.nodes = limit;
+    else
+        limits.movetime = limit;
 
+    vector<bool> chess960;
+    vector<string> fens = setup_positions(engine, fenFile, chess960);
 
-  // bench() is called when the engine receives the "bench" command.
-  // Firstly, a list of UCI commands is set up according to the bench
-  // parameters, then it is run one by one, printing a summary at the end.
+    engine.hot_swap();
+    Eval::NNUE::verify(engine);
+    engine.clear();
 
-  void bench(Position& pos, istream& args, StateListPtr& states) {
+    TimePoint elapsed = now();
+
+    engine.threads.analyse(fens, chess960, limits);
+
+    elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+
+    cerr << "\n==========================="
+         << "\nPositions analysed : " << engine.threads.analysisDone
+         << "\nThreads            : " << engine.threads.size()
+         << "\nTotal time (ms)    : " << elapsed
+         << "\nPositions/second   : " << engine.threads.analysisDone * 1000.0 / elapsed
+         << "\nNodes searched     : " << engine.threads.analysisNodes
+         << "\nNodes/second       : " << 1000 * engine.threads.analysisNodes / elapsed << endl;
+  }
+
+  // solve() is called when the engine receives the "solve" command. It searches
+  // each position of an EPD file that has "bm" (best move) or "am" (avoid move)
+  // operations, first with the iterative deepening and then with MCTS, with the
+  // current options and the same time for both. The time to solution is the time
+  // after which the best move of the PV stayed a correct one until the end. The
+  // positions with a "dm" (direct mate) operation are searched with "go mate",
+  // with the iterative deepening and then with the proof-number search, and the
+  // time to solution is the time of the first mate score within the moves:
+  // solve [epdFile] [movetime]
+
+  void solve(Engine& engine, istream& args) {
 
     string token;
-    uint64_t num, nodes = 0, cnt = 1;
+    string epdFile     = (args >> token) ? token : "";
+    int64_t movetime   = 10000;
 
-    vector<string> list = setup_bench(pos, args);
-    num = count_if(list.begin(), list.end(), [](string s) { return s.find("go ") == 0 || s.find("eval") == 0; });
+    if ((args >> token) && (!parse_number(token, movetime) || movetime < 1))
+    {
+        sync_cout << "Invalid movetime " << token << sync_endl;
+        return;
+    }
 
-    TimePoint elapsed = now();
+    ifstream file(epdFile);
+    if (!file.is_open())
+    {
+        sync_cout << "Unable to open file " << epdFile << sync_endl;
+        return;
+    }
 
-    for (const auto& cmd : list)
+    struct Problem { string fen, id; vector<string> bm, am; int dm = 0; };
+    vector<Problem> problems;
+
+    for (string line; getline(file, line); )
     {
-        istringstream is(cmd);
-        is >> skipws >> token;
+        Problem p;
+        string field, op;
+        bool valid = true;
+        istringstream ss(line);
 
-        if (token == "go" || token == "eval")
+        for (int i = 0; i < 4 && ss >> field; ++i)
+            p.fen += field + " ";
+
+        while (getline(ss, op, ';'))
         {
-            cerr << "\nPosition: " << cnt++ << '/' << num << " (" << pos.fen() << ")" << endl;
-            if (token == "go")
-            {
-               go(pos, is, states);
-               Threads.main()->wait_for_search_finished();
-               nodes += Threads.nodes_searched();
-            }
-            else
-               trace_eval(pos);
+            istringstream os(op);
+            string opcode, operand;
+            os >> opcode;
+
+            while (os >> operand)
+                if (opcode == "bm")
+                    p.bm.push_back(operand);
+                else if (opcode == "am")
+                    p.am.push_back(operand);
+                else if (opcode == "dm")
+                {
+                    int64_t dm;
+                    if (parse_number(operand, dm) && dm > 0 && dm <= MAX_PLY / 2)
+                        p.dm = int(dm);
+                    else
+                        valid = false;
+                }
+                else if (opcode == "id")
+                    p.id += (p.id.empty() ? "" : " ") + operand;
         }
-        else if (token == "setoption")  setoption(is);
-        else if (token == "position")   position(pos, is, states);
-        else if (token == "ucinewgame") { Search::clear(); elapsed = now(); } // Search::clear() may take a while
+
+        if (!valid)
+            sync_cout << "Invalid dm operation, skipping " << line << sync_endl;
+
+        else if (!p.bm.empty() || !p.am.empty() || p.dm > 0)
+            problems.push_back(p);
     }
 
-    elapsed = now() - elapsed + 1; // Ensure positivity to avoid a 'divide by zero'
+    // The search output is parsed to follow the best move of the PV, or to find
+    // the first mate score within the moves of a "dm" operation.
+    vector<string> correctMoves, wrongMoves;
+    TimePoint solvedAt;
+    string bestMove;
+    int mateMoves = 0;
+
+    auto correct = [&](const string& m) {
+        return correctMoves.empty() ? find(wrongMoves.begin(), wrongMoves.end(), m) == wrongMoves.end()
+                                    : find(correctMoves.begin(), correctMoves.end(), m) != correctMoves.end();
+    };
+
+    Engine solver([&](const string& line) {
+        istringstream is(line);
+        string tok, pvMove;
+        TimePoint time = -1;
+        int multiPV = 1, mate = 0;
+
+        is >> tok;
+        if (tok == "bestmove")
+            is >> bestMove;
+
+        if (tok != "info")
+            return;
+
+        while (is >> tok)
+            if (tok == "multipv")   is >> multiPV;
+            else if (tok == "mate") is >> mate;
+            else if (tok == "time") is >> time;
+            else if (tok == "pv")   { is >> pvMove; break; }
+
+        if (pvMove.empty() || multiPV != 1)
+            return;
+
+        if (mateMoves)
+        {
+            if (solvedAt < 0 && mate > 0 && mate <= mateMoves)
+                solvedAt = time;
+            return;
+        }
 
-    dbg_print();
+        if (!correct(pvMove))
+            solvedAt = -1;
+        else if (solvedAt < 0)
+            solvedAt = time;
+    });
+
+    for (auto& it : solver.options)
+        if (it.first != "Threads" && it.first != "Hash")
+            it.second.copy_value(engine.options[it.first]);
+
+    solver.options["Threads"] = string(engine.options["Threads"]);
+    solver.options["Hash"] = string(engine.options["Hash"]);
+    solver.options["Info Interval"] = string("0");
+
+    enum { AlphaBeta, MCTS, PNS, ModeNb };
+    const string modes[] = { "alpha-beta", "MCTS", "PNS" };
+    int searched[ModeNb] = {}, solved[ModeNb] = {};
+    TimePoint totalTime[ModeNb] = {};
+
+    for (size_t i = 0; i < problems.size(); ++i)
+    {
+        const Problem& p = problems[i];
+        StateListPtr states(new std::deque<StateInfo>(1));
+        Position pos;
+        pos.set(p.fen + "0 1", engine.options["UCI_Chess960"], &states->back(), engine.threads.main());
+
+        // Accept the moves in SAN as well as in coordinates
+        auto strip = [](string m) {
+            m.erase(remove_if(m.begin(), m.end(), [](char c) { return strchr("+#!?", c); }), m.end());
+            return m;
+        };
+
+        correctMoves.clear();
+        wrongMoves.clear();
+        for (const auto& m : MoveList<LEGAL>(pos))
+        {
+            string san = strip(Selfplay::san(pos, m)), uci = UCI::move(m, pos.is_chess960());
+            for (const string& bm : p.bm)
+                if (strip(bm) == san || bm == uci)
+                    correctMoves.push_back(uci);
+            for (const string& am : p.am)
+                if (strip(am) == san || am == uci)
+                    wrongMoves.push_back(uci);
+        }
+
+        string result = "problem " + to_string(i + 1) + "/" + to_string(problems.size())
+                      + (p.id.empty() ? "" : " id " + p.id);
+
+        mateMoves = p.dm;
+
+        for (int mode : { AlphaBeta, p.dm ? PNS : MCTS })
+        {
+            solver.options["MCTS"] = string(mode == MCTS ? "true" : "false");
+            solver.options["PNS"] = string(mode == PNS ? "true" : "false");
+            solver.clear();
+
+            istringstream posArgs("fen " + p.fen + "0 1");
+            istringstream goArgs((p.dm ? "mate " + to_string(p.dm) + " " : "") + "movetime " + to_string(movetime));
+            solvedAt = -1;
+            bestMove.clear();
+
+            solver.position(posArgs);
+            solver.go(goArgs);
+            solver.wait_for_search_finished();
+
+            bool ok = (p.dm || correct(bestMove)) && solvedAt >= 0;
+            searched[mode]++;
+            solved[mode] += ok;
+            totalTime[mode] += ok ? solvedAt : movetime;
+            result += " " + modes[mode] + " " + (ok ? to_string(solvedAt) : string("-"));
+        }
+
+        sync_cout << result << sync_endl;
+    }
 
     cerr << "\n==========================="
-         << "\nTotal time (ms) : " << elapsed
-         << "\nNodes searched  : " << nodes
-         << "\nNodes/second    : " << 1000 * nodes / elapsed << endl;
+         << "\nProblems            : " << problems.size();
+
+    for (int mode = 0; mode < ModeNb; ++mode)
+        if (searched[mode])
+            cerr << "\nSolved " << left << setw(13) << modes[mode] << right << ": " << solved[mode]
+                 << "/" << searched[mode] << " in " << totalTime[mode] << " ms";
+
+    cerr << "\n(the unsolved problems count for the whole movetime)" << endl;
   }
 
   // The win rate model returns the probability of winning (in per mille units) given an
@@ -228,13 +562,12 @@ namespace {
 /// like running 'bench', the function returns immediately after the command is executed.
 /// In addition to the UCI ones, some additional debug commands are also supported.
 
-void UCI::loop(int argc, char* argv[]) {
+void UCI::loop(Engine& engine, int argc, char* argv[]) {
 
-  Position pos;
   string token, cmd;
-  StateListPtr states(new std::deque<StateInfo>(1));
+  istringstream startpos("startpos");
 
-  pos.set(StartFEN, false, &states->back(), Threads.main());
+  engine.position(startpos);
 
   for (int i = 1; i < argc; ++i)
       cmd += std::string(argv[i]) + " ";
@@ -250,40 +583,51 @@ void UCI::loop(int argc, char* argv[]) {
 
       if (    token == "quit"
           ||  token == "stop")
-          Threads.stop = true;
+          engine.stop();
 
       // The GUI sends 'ponderhit' to tell that the user has played the expected move.
       // So, 'ponderhit' is sent if pondering was done on the same move that the user
       // has played. The search should continue, but should also switch from pondering
       // to the normal search.
       else if (token == "ponderhit")
-          Threads.main()->ponder = false; // Switch to the normal search
+          engine.ponderhit(); // Switch to the normal search
 
       else if (token == "uci")
           sync_cout << "id name " << engine_info(true)
-                    << "\n"       << Options
+                    << "\n"       << engine.options
                     << "\nuciok"  << sync_endl;
 
-      else if (token == "setoption")  setoption(is);
-      else if (token == "go")         go(pos, is, states);
-      else if (token == "position")   position(pos, is, states);
-      else if (token == "ucinewgame") Search::clear();
+      else if (token == "setoption")  engine.setoption(is);
+      else if (token == "go")         engine.go(is);
+      else if (token == "position")   engine.position(is);
+      else if (token == "ucinewgame") new_game(engine);
       else if (token == "isready")    sync_cout << "readyok" << sync_endl;
 
       // Add custom non-UCI commands, mainly for debugging purposes.
       // These commands must not be used during a search!
-      else if (token == "flip")     pos.flip();
-      else if (token == "bench")    bench(pos, is, states);
-      else if (token == "d")        sync_cout << pos << sync_endl;
-      else if (token == "eval")     trace_eval(pos);
+      else if (token == "flip")     engine.pos.flip();
+      else if (token == "bench")    bench(engine, is);
+      else if (token == "nnuebench") nnuebench(engine, is);
+      else if (token == "analyse")  analyse(engine, is);
+      else if (token == "solve")    solve(engine, is);
+      else if (token == "selfplay") Selfplay::match(engine, is);
+      else if (token == "gensfen")  Datagen::gensfen(engine, is);
+      else if (token == "rescore")  Datagen::rescore(engine, is);
+      else if (token == "d")        sync_cout << engine.pos << sync_endl;
+      else if (token == "eval")     trace_eval(engine);
       else if (token == "compiler") sync_cout << compiler_info() << sync_endl;
       else if (token == "export_net")
       {
           std::optional<std::string> filename;
+          bool compact = false;
           std::string f;
-          if (is >> skipws >> f)
-              filename = f;
-          Eval::NNUE::save_eval(filename);
+          while (is >> skipws >> f)
+              if (f == "int8")
+                  compact = true;
+              else
+                  filename = f;
+          engine.hot_swap();
+          Eval::NNUE::save_eval(filename, compact);
       }
       else if (token == "--help" || token == "help" || token == "--license" || token == "license")
           sync_cout << "\nStockfish is a powerful chess engine for playing and analyzing."
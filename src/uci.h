@@ -19,6 +19,7 @@
 #ifndef UCI_H_INCLUDED
 #define UCI_H_INCLUDED
 
+#include <functional>
 #include <map>
 #include <string>
 
@@ -26,6 +27,7 @@
 
 namespace Stockfish {
 
+class Engine;
 class Position;
 
 namespace UCI {
@@ -43,7 +45,7 @@ typedef std::map<std::string, Option, CaseInsensitiveLess> OptionsMap;
 /// The Option class implements each option as specified by the UCI protocol
 class Option {
 
-  typedef void (*OnChange)(const Option&);
+  typedef std::function<void(const Option&)> OnChange;
 
 public:
   Option(OnChange = nullptr);
@@ -54,6 +56,7 @@ public:
 
   Option& operator=(const std::string&);
   void operator<<(const Option&);
+  void copy_value(const Option&);
   operator double() const;
   operator std::string() const;
   bool operator==(const char*) const;
@@ -67,8 +70,8 @@ private:
   OnChange on_change;
 };
 
-void init(OptionsMap&);
-void loop(int argc, char* argv[]);
+void init(OptionsMap&, Engine&);
+void loop(Engine&, int argc, char* argv[]);
 std::string value(Value v);
 std::string square(Square s);
 std::string move(Move m, bool chess960);
@@ -78,8 +81,6 @@ Move to_move(const Position& pos, std::string& str);
 
 } // namespace UCI
 
-extern UCI::OptionsMap Options;
-
 } // namespace Stockfish
 
 #endif // #ifndef UCI_H_INCLUDED
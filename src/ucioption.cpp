@@ -17,15 +17,15 @@
 */
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <ostream>
 #include <sstream>
+#include <vector>
 
+#include "engine.h"
 #include "evaluate.h"
 #include "misc.h"
-#include "search.h"
-#include "thread.h"
-#include "tt.h"
 #include "uci.h"
 #include "syzygy/tbprobe.h"
 
@@ -33,18 +33,13 @@ using std::string;
 
 namespace Stockfish {
 
-UCI::OptionsMap Options; // Global object
-
 namespace UCI {
 
-/// 'On change' actions, triggered by an option's value change
-void on_clear_hash(const Option&) { Search::clear(); }
-void on_hash_size(const Option& o) { TT.resize(size_t(o)); }
+/// 'On change' actions, triggered by an option's value change. The ones acting
+/// on the engine instance are bound to it in init().
 void on_logger(const Option& o) { start_logger(o); }
-void on_threads(const Option& o) { Threads.set(size_t(o)); }
 void on_tb_path(const Option& o) { Tablebases::init(o); }
-void on_use_NNUE(const Option& ) { Eval::NNUE::init(); }
-void on_eval_file(const Option& ) { Eval::NNUE::init(); }
+void on_binary_output(const Option& o) { set_binary_stdout(o); }
 
 /// Our case insensitive less() function as required by UCI protocol
 bool CaseInsensitiveLess::operator() (const string& s1, const string& s2) const {
@@ -54,12 +49,19 @@ bool CaseInsensitiveLess::operator() (const string& s1, const string& s2) const
 }
 
 
-/// UCI::init() initializes the UCI options to their hard-coded default values
+/// UCI::init() initializes the UCI options of an engine to their hard-coded
+/// default values
 
-void init(OptionsMap& o) {
+void init(OptionsMap& o, Engine& engine) {
 
   constexpr int MaxHashMB = Is64Bit ? 33554432 : 2048;
 
+  auto on_clear_hash = [&](const Option&) { engine.clear(); };
+  auto on_hash_size  = [&](const Option& opt) { engine.tt.resize(size_t(opt), engine.threads); };
+  auto on_threads    = [&](const Option& opt) { engine.threads.set(size_t(opt)); };
+  auto on_eval_file  = [&](const Option&) { Eval::NNUE::init(engine.options); };
+  auto on_use_NNUE   = on_eval_file;
+
   o["Debug Log File"]        << Option("", on_logger);
   o["Threads"]               << Option(1, 1, 512, on_threads);
   o["Hash"]                  << Option(16, 1, MaxHashMB, on_hash_size);
@@ -75,37 +77,57 @@ void init(OptionsMap& o) {
   o["UCI_LimitStrength"]     << Option(false);
   o["UCI_Elo"]               << Option(1350, 1350, 2850);
   o["UCI_ShowWDL"]           << Option(false);
+  o["Async Output"]          << Option(false);
+  o["Info Interval"]         << Option(0, 0, 10000);
+  o["Binary Output"]         << Option(false, on_binary_output);
   o["SyzygyPath"]            << Option("<empty>", on_tb_path);
   o["SyzygyProbeDepth"]      << Option(1, 1, 100);
   o["Syzygy50MoveRule"]      << Option(true);
   o["SyzygyProbeLimit"]      << Option(7, 0, 7);
   o["Use NNUE"]              << Option(true, on_use_NNUE);
   o["EvalFile"]              << Option(EvalFileDefaultName, on_eval_file);
+  o["EvalFileSmall"]         << Option("<empty>", on_eval_file);
+  o["NNUE Eager Update"]     << Option(false, on_use_NNUE);
+  o["NNUE Prefetch"]         << Option(false, on_use_NNUE);
+  o["NNUE Hot Swap"]         << Option(false);
+  o["MCTS"]                  << Option(false);
+  o["MCTS Leaf Depth"]       << Option(2, 0, 20);
+  o["MCTS Exploration"]      << Option(200, 0, 1000);
+  o["MCTS Transpositions"]   << Option(true);
+  o["MCTS Hash"]             << Option(128, 1, MaxHashMB);
+  o["PNS"]                   << Option(true);
+  o["PNS Hash"]              << Option(16, 1, MaxHashMB);
+  o["PNS Verify"]            << Option(false);
 }
 
 
 /// operator<<() is used to print all the options default values in chronological
 /// insertion order (the idx field) and in the format defined by the UCI protocol.
+/// The idx counter is shared by the options of all the engine instances, so we
+/// sort on it instead of expecting the indices of a map to start from zero.
 
 std::ostream& operator<<(std::ostream& os, const OptionsMap& om) {
 
-  for (size_t idx = 0; idx < om.size(); ++idx)
-      for (const auto& it : om)
-          if (it.second.idx == idx)
-          {
-              const Option& o = it.second;
-              os << "\noption name " << it.first << " type " << o.type;
+  std::vector<const OptionsMap::value_type*> ordered;
+  for (const auto& it : om)
+      ordered.push_back(&it);
+
+  std::sort(ordered.begin(), ordered.end(),
+            [](const auto* a, const auto* b) { return a->second.idx < b->second.idx; });
 
-              if (o.type == "string" || o.type == "check" || o.type == "combo")
-                  os << " default " << o.defaultValue;
+  for (const auto* it : ordered)
+  {
+      const Option& o = it->second;
+      os << "\noption name " << it->first << " type " << o.type;
 
-              if (o.type == "spin")
-                  os << " default " << int(stof(o.defaultValue))
-                     << " min "     << o.min
-                     << " max "     << o.max;
+      if (o.type == "string" || o.type == "check" || o.type == "combo")
+          os << " default " << o.defaultValue;
 
-              break;
-          }
+      if (o.type == "spin")
+          os << " default " << int(stof(o.defaultValue))
+             << " min "     << o.min
+             << " max "     << o.max;
+  }
 
   return os;
 }
@@ -149,13 +171,24 @@ bool Option::operator==(const char* s) const {
 
 void Option::operator<<(const Option& o) {
 
-  static size_t insert_order = 0;
+  static std::atomic<size_t> insert_order = 0;
 
   *this = o;
   idx = insert_order++;
 }
 
 
+/// copy_value() sets the value of the same option of another engine, without
+/// calling on_change(), for instance to share the settings of the networks.
+
+void Option::copy_value(const Option& o) {
+
+  assert(type == o.type);
+
+  currentValue = o.currentValue;
+}
+
+
 /// operator=() updates currentValue and triggers on_change() action. It's up to
 /// the GUI to check for option's limits, but we could receive the new value
 /// from the user by console window, so let's check the bounds anyway.
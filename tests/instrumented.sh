@@ -70,7 +70,8 @@ for args in "eval" \
             "go depth 10" \
             "go movetime 1000" \
             "go wtime 8000 btime 8000 winc 500 binc 500" \
-            "bench 128 $threads 8 default depth"
+            "bench 128 $threads 8 default depth" \
+            "selfplay default nodes 1000 2 selfplay.pgn"
 do
 
    echo "$prefix $exeprefix ./stockfish $args $postfix"
@@ -78,6 +79,25 @@ do
 
 done
 
+rm -f selfplay.pgn
+
+# training data round trip, 100 positions in records of 40 bytes are generated
+# and then rescored
+rm -f gensfen.bin rescored.bin
+for args in "gensfen depth 4 100 gensfen.bin current 4" \
+            "rescore gensfen.bin rescored.bin depth 4"
+do
+
+   echo "$prefix $exeprefix ./stockfish $args $postfix"
+   eval "$prefix $exeprefix ./stockfish $args $postfix"
+
+done
+
+[ "$(wc -c < gensfen.bin)" -eq 4000 ]
+[ "$(wc -c < rescored.bin)" -eq 4000 ]
+
+rm -f gensfen.bin rescored.bin
+
 # more general testing, following an uci protocol exchange
 cat << EOF > game.exp
  set timeout 240
@@ -109,6 +129,74 @@ cat << EOF > game.exp
  exit \$value
 EOF
 
+# MCTS searches, with and without alpha-beta leaf searches, and then more of
+# them than the generations of the MCTS node table
+cat << EOF > mcts.exp
+ set timeout 240
+ spawn $exeprefix ./stockfish
+
+ send "uci\n"
+ expect "uciok"
+
+ send "setoption name Threads value $threads\n"
+ send "setoption name MCTS value true\n"
+
+ send "position fen r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3\n"
+ send "go nodes 5000\n"
+ expect "bestmove"
+
+ send "setoption name MCTS Leaf Depth value 0\n"
+ send "go nodes 5000\n"
+ expect "bestmove"
+
+ send "setoption name MCTS Hash value 1\n"
+
+ for {set i 0} {\$i < 300} {incr i} {
+   send "position startpos\n"
+   send "go nodes 200\n"
+   expect "bestmove"
+ }
+
+ send "quit\n"
+ expect eof
+
+ # return error code of the spawned program, useful for valgrind
+ lassign [wait] pid spawnid os_error_flag value
+ exit \$value
+EOF
+
+# go mate, with and without the proof-number search
+cat << EOF > pns.exp
+ set timeout 240
+ spawn $exeprefix ./stockfish
+
+ send "uci\n"
+ expect "uciok"
+
+ send "setoption name Threads value $threads\n"
+
+ foreach pns {true false} {
+   send "setoption name PNS value \$pns\n"
+
+   send "position fen r2qkb1r/pp2nppp/3p4/2pNN1B1/2BnP3/3P4/PPP2PPP/R2bK2R w KQkq - 0 1\n"
+   send "go mate 2\n"
+   expect "score mate 2" {} timeout {exit 1}
+   expect "bestmove"
+
+   send "position fen 1k1r4/pp1b1R2/3q2pp/4p3/2B5/4Q3/PPP2B2/2K5 b - - 0 1\n"
+   send "go mate 3\n"
+   expect "score mate 3" {} timeout {exit 1}
+   expect "bestmove"
+ }
+
+ send "quit\n"
+ expect eof
+
+ # return error code of the spawned program, useful for valgrind
+ lassign [wait] pid spawnid os_error_flag value
+ exit \$value
+EOF
+
 #download TB as needed
 if [ ! -d ../tests/syzygy ]; then
    curl -sL https://api.github.com/repos/niklasf/python-chess/tarball/9b9aa13f9f36d08aadfabff872882f4ab1494e95 | tar -xzf -
@@ -130,7 +218,7 @@ cat << EOF > syzygy.exp
  exit \$value
 EOF
 
-for exp in game.exp syzygy.exp
+for exp in game.exp mcts.exp pns.exp syzygy.exp
 do
 
   echo "$prefix expect $exp $postfix"
@@ -0,0 +1,94 @@
+#!/bin/bash
+# compare the speed of two binaries on the same bench
+#
+# usage: perfcmp.sh base test [runs [threshold [bench arguments]]]
+#
+# The two binaries are run in turn, runs times each, so that a change of the
+# machine load affects both of them alike. The relative change of Nodes/second
+# is computed on each pair of runs, and the script fails if the test binary is
+# slower than the base by more than threshold percent (default 1) with 95%
+# confidence. Set CPUS to a core list (e.g. CPUS=3) to pin the runs with
+# taskset, and SETUP to UCI commands sent before the bench, for example
+# SETUP="setoption name EvalFile value nn.nnue".
+
+error()
+{
+  echo "perfcmp failed on line $1"
+  exit 2
+}
+trap 'error ${LINENO}' ERR
+
+if [ $# -lt 2 ]; then
+   echo "usage: $0 base test [runs [threshold [bench arguments]]]"
+   exit 2
+fi
+
+base=$1
+test=$2
+runs=${3:-10}
+threshold=${4:-1}
+shift $(( $# < 4 ? $# : 4 ))
+args="$*"
+
+pin=""
+if [ -n "$CPUS" ]; then
+   pin="taskset -c $CPUS"
+fi
+
+# run a bench and print its Nodes/second
+nps()
+{
+  printf "%s\nbench %s\nquit\n" "$SETUP" "$args" | $pin $1 2>&1 | grep "Nodes/second" | awk '{print $3}'
+}
+
+echo "perfcmp: $runs runs of bench $args"
+
+samples=""
+for i in $(seq 1 $runs); do
+   a=$(nps $base)
+   b=$(nps $test)
+   if [ -z "$a" ] || [ -z "$b" ]; then
+      echo "No Nodes/second obtained from bench. Code crashed or assert triggered ?"
+      exit 2
+   fi
+   echo "run $i: base $a test $b"
+   samples="$samples $a $b"
+done
+
+# mean and 95% confidence interval of the relative change, in percent, with
+# the quantiles of the Student t-distribution for few runs.
+echo $samples | awk -v threshold=$threshold '
+{
+  n = NF / 2
+  for (i = 1; i <= n; i++) {
+     a = $(2 * i - 1); b = $(2 * i)
+     sa += a; sb += b
+     d[i] = 100 * (b - a) / a
+     sd += d[i]
+  }
+  mean = sd / n
+  for (i = 1; i <= n; i++)
+     var += (d[i] - mean) ^ 2
+  var = n > 1 ? var / (n - 1) : 0
+
+  split("12.71 4.30 3.18 2.78 2.57 2.45 2.36 2.31 2.26 2.23 2.20 2.18 2.16 2.14 2.13", t)
+  q = n - 1 <= 15 ? t[n - 1] : n - 1 <= 30 ? 2.09 : 1.96
+  ci = n > 1 ? q * sqrt(var / n) : 0
+  tstat = var > 0 ? mean / sqrt(var / n) : 0
+
+  printf "base nps %d test nps %d\n", sa / n, sb / n
+  printf "change %+.2f%% +/- %.2f%% (95%%), t = %.2f\n", mean, ci, tstat
+
+  if (n < 2)
+     print "not enough runs for a confidence interval"
+  else if (mean + ci < -threshold) {
+     printf "slowdown beyond %s%%\n", threshold
+     exit 1
+  }
+  else if (mean + ci < 0)
+     print "significant slowdown, within the threshold"
+  else if (mean - ci > 0)
+     print "significant speedup"
+  else
+     print "no significant change"
+}' || exit 1